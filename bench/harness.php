@@ -0,0 +1,309 @@
+<?php
+
+/*
+  Run a fixed matrix of lexer and parser workloads and report the p50, p90
+  and max time of the samples along with the peak memory of the Zend heap
+  while a workload runs. Tables built by the extension itself aren't on
+  that heap, the peak covers the tokens, arrays and strings handed to PHP.
+  Inputs are generated from a fixed seed.
+
+  Results can be saved as a baseline and later runs compared against it.
+  The comparison fails with exit code 1 when the p50 time or the peak
+  memory of a workload grew by more than the threshold. Baselines are only
+  comparable on the same machine and with the same build options, the
+  UTF-32 and id width settings are stored with them and checked.
+
+  Usage: php harness.php [--samples=N] [--only=name,...] [--save=FILE]
+                         [--compare=FILE] [--threshold=PERCENT, default 10]
+ */
+
+use Parle\Lexer;
+use Parle\Parser;
+use Parle\RLexer;
+use Parle\RParser;
+use Parle\Token;
+
+$opts = getopt('', array('samples:', 'only:', 'save:', 'compare:', 'threshold:'));
+$samples = isset($opts['samples']) ? max(1, (int)$opts['samples']) : 15;
+$only = isset($opts['only']) ? explode(',', $opts['only']) : array();
+$threshold = isset($opts['threshold']) ? (float)$opts['threshold'] : 10.0;
+
+$config = array(
+	'parle' => phpversion('parle'),
+	'php' => PHP_VERSION,
+	'utf32' => Parle\INTERNAL_UTF32,
+);
+
+mt_srand(42);
+$csv = genCsv(20000);
+$text = genText(20000);
+$exprs = array();
+for ($i = 0; $i < 5000; $i++) {
+	$exprs[] = genExpr(mt_rand(2, 6));
+}
+
+/* name => function returning the closure to time */
+$workloads = array(
+	'lexer' => function () use ($csv) {
+		$lex = csvLexer(new Lexer);
+		return function () use ($lex, $csv) {
+			lexAll($lex, $csv);
+		};
+	},
+	'rlexer' => function () use ($csv) {
+		$lex = csvLexer(new RLexer);
+		return function () use ($lex, $csv) {
+			lexAll($lex, $csv);
+		};
+	},
+	'lexer_callouts' => function () use ($csv) {
+		$lex = csvLexer(new Lexer);
+		$fields = 0;
+		$lex->callout(1, function () use (&$fields) {
+			$fields++;
+		});
+		return function () use ($lex, $csv) {
+			lexAll($lex, $csv);
+		};
+	},
+	'lexer_multibyte' => function () use ($text) {
+		$lex = new Lexer;
+		$lex->push("[^\\s\\d.,;!?]+", 1);
+		$lex->push("\\d+", 2);
+		$lex->push("[.,;!?]", 3);
+		$lex->push("\\s+", Token::SKIP);
+		$lex->build();
+		return function () use ($lex, $text) {
+			lexAll($lex, $text);
+		};
+	},
+	'tokenize' => function () use ($csv) {
+		$lex = csvLexer(new Lexer);
+		return function () use ($lex, $csv) {
+			$lex->consume($csv);
+			$lex->tokenize(1);
+		};
+	},
+	'validate' => function () use ($exprs) {
+		list($p, $lex) = exprParser(new Parser, new Lexer, 0);
+		return function () use ($p, $lex, $exprs) {
+			foreach ($exprs as $in) {
+				$p->validate($in, $lex);
+			}
+		};
+	},
+	'validate_compressed' => function () use ($exprs) {
+		list($p, $lex) = exprParser(new Parser, new Lexer, Parser::DEFAULT_REDUCTIONS | Parser::COMPRESS_TABLE);
+		return function () use ($p, $lex, $exprs) {
+			foreach ($exprs as $in) {
+				$p->validate($in, $lex);
+			}
+		};
+	},
+	'reductions' => function () use ($exprs) {
+		list($p, $lex) = exprParser(new Parser, new Lexer, 0);
+		return function () use ($p, $lex, $exprs) {
+			advanceAll($p, $lex, $exprs);
+		};
+	},
+	'rparser_reductions' => function () use ($exprs) {
+		list($p, $lex) = exprParser(new RParser, new RLexer, 0);
+		return function () use ($p, $lex, $exprs) {
+			advanceAll($p, $lex, $exprs);
+		};
+	},
+	'build_lexer' => function () {
+		return function () {
+			$lex = new Lexer;
+			foreach (array('select', 'from', 'where', 'insert', 'into', 'values', 'update', 'delete', 'order', 'group', 'by', 'having') as $i => $kw) {
+				$lex->push($kw, $i + 1);
+			}
+			$lex->push("[a-zA-Z_][a-zA-Z0-9_]*", 100);
+			$lex->push("\\d+(\\.\\d+)?", 101);
+			$lex->push("'([^']|'')*'", 102);
+			$lex->push("[-+*/=<>(),;.]", 103);
+			$lex->push("\\s+", Token::SKIP);
+			$lex->build();
+		};
+	},
+	'build_parser' => function () {
+		return function () {
+			exprParser(new Parser, new Lexer, 0);
+		};
+	},
+);
+
+$results = array();
+printf("%-20s %10s %10s %10s %12s\n", 'workload', 'p50 ms', 'p90 ms', 'max ms', 'peak bytes');
+foreach ($workloads as $name => $setup) {
+	if ($only && !in_array($name, $only)) {
+		continue;
+	}
+	$results[$name] = runWorkload($setup, $samples);
+	printf("%-20s %10.3f %10.3f %10.3f %12d\n", $name, $results[$name]['p50'] * 1000, $results[$name]['p90'] * 1000, $results[$name]['max'] * 1000, $results[$name]['peak']);
+}
+
+if (isset($opts['save'])) {
+	file_put_contents($opts['save'], json_encode(array('config' => $config, 'results' => $results), JSON_PRETTY_PRINT) . "\n");
+	echo "\n", 'Saved the baseline to ', $opts['save'], "\n";
+}
+
+if (isset($opts['compare'])) {
+	exit(compareBaseline($opts['compare'], $config, $results, $threshold));
+}
+
+function runWorkload(Closure $setup, int $samples)
+{
+	$fn = $setup();
+	$fn();
+
+	if (function_exists('memory_reset_peak_usage')) {
+		memory_reset_peak_usage();
+	}
+	$base = memory_get_usage();
+	$times = array();
+	for ($i = 0; $i < $samples; $i++) {
+		$start = hrtime(true);
+		$fn();
+		$times[] = (hrtime(true) - $start) / 1e9;
+	}
+	sort($times);
+
+	return array(
+		'p50' => percentile($times, 50),
+		'p90' => percentile($times, 90),
+		'max' => end($times),
+		'peak' => max(0, memory_get_peak_usage() - $base),
+	);
+}
+
+function percentile(array $sorted, $p)
+{
+	return $sorted[(int)min(count($sorted) - 1, floor(count($sorted) * $p / 100))];
+}
+
+function compareBaseline($file, array $config, array $results, $threshold)
+{
+	$base = json_decode((string)@file_get_contents($file), true);
+	if (!is_array($base) || !isset($base['config'], $base['results'])) {
+		echo 'Cannot read the baseline ', $file, "\n";
+		return 2;
+	}
+	foreach (array('utf32') as $key) {
+		if ($base['config'][$key] !== $config[$key]) {
+			echo 'The baseline was taken with ', $key, ' ', var_export($base['config'][$key], true), ', this build has ', var_export($config[$key], true), "\n";
+			return 2;
+		}
+	}
+
+	$failed = 0;
+	echo "\n", sprintf("%-20s %10s %10s  %s", 'workload', 'time', 'peak', 'against ' . $file), "\n";
+	foreach ($results as $name => $cur) {
+		if (!isset($base['results'][$name])) {
+			continue;
+		}
+		$old = $base['results'][$name];
+		$time = ($cur['p50'] / $old['p50'] - 1) * 100;
+		$peak = $old['peak'] > 0 ? ($cur['peak'] / $old['peak'] - 1) * 100 : 0;
+		/* Peaks within a few kB are allocator noise. */
+		$regressed = $time > $threshold || ($peak > $threshold && $cur['peak'] - $old['peak'] > 4096);
+		$failed += $regressed;
+		printf("%-20s %+9.1f%% %+9.1f%%  %s\n", $name, $time, $peak, $regressed ? 'REGRESSION' : 'ok');
+	}
+	echo "\n", $failed ? $failed . ' regression(s) above ' . $threshold . '%' : 'No regressions above ' . $threshold . '%', "\n";
+
+	return $failed ? 1 : 0;
+}
+
+function csvLexer($lex)
+{
+	$lex->push("[^\"\\,\r\n]+", 1);
+	$lex->push("[\"]([^\"]|[\"][\"])*[\"]", 2);
+	$lex->push("[,]", 3);
+	$lex->push("[\r]?[\n]", 4);
+	$lex->build();
+
+	return $lex;
+}
+
+function lexAll($lex, $in)
+{
+	$lex->consume($in);
+	$lex->advance();
+	while (Token::EOI != $lex->getToken()->id) {
+		$lex->advance();
+	}
+}
+
+function exprParser($p, $lex, $flags)
+{
+	$p->token("NUM");
+	$p->left("'+' '-'");
+	$p->left("'*' '/'");
+	$p->push("start", "exp");
+	foreach (array('+', '-', '*', '/') as $op) {
+		$p->push("exp", "exp '$op' exp");
+	}
+	$p->push("exp", "'(' exp ')'");
+	$p->push("exp", "NUM");
+	$p->build($flags);
+
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	foreach (array('+', '-', '*', '/', '(', ')') as $op) {
+		$lex->push("\\" . $op, $p->tokenId("'$op'"));
+	}
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	return array($p, $lex);
+}
+
+function advanceAll($p, $lex, array $inputs)
+{
+	$reductions = 0;
+	foreach ($inputs as $in) {
+		$p->consume($in, $lex);
+		while ($p::ACTION_ERROR != $p->action && $p::ACTION_ACCEPT != $p->action) {
+			if ($p::ACTION_REDUCE == $p->action) {
+				$reductions++;
+			}
+			$p->advance();
+		}
+	}
+
+	return $reductions;
+}
+
+function genCsv($rows)
+{
+	$words = array('hallo', 'world', 'foo', 'bar', 'more', 'stuff', 'rare');
+	$out = '';
+	for ($i = 0; $i < $rows; $i++) {
+		$out .= mt_rand(1, 99999) . ',' . $words[mt_rand(0, 6)] . ' ' . $words[mt_rand(0, 6)] . ',"' . $words[mt_rand(0, 6)] . ', ""quoted"""' . ',' . mt_rand(0, 999) . '.' . mt_rand(0, 99) . "\n";
+	}
+
+	return $out;
+}
+
+function genText($words)
+{
+	$dict = array('Straße', 'café', 'naïve', 'Größe', 'élan', 'plain', 'words', 'Ωmega', 'δelta', 'über');
+	$punct = array('.', ',', ';', '!', '?');
+	$out = '';
+	for ($i = 0; $i < $words; $i++) {
+		$out .= $dict[mt_rand(0, 9)] . (mt_rand(0, 4) ? ' ' : $punct[mt_rand(0, 4)] . ' ' . mt_rand(1, 2024) . ' ');
+	}
+
+	return $out;
+}
+
+function genExpr($depth)
+{
+	if ($depth <= 0 || mt_rand(0, 3) == 0) {
+		return (string)mt_rand(0, 1000);
+	}
+	$ops = array('+', '-', '*', '/');
+	$ret = genExpr($depth - 1) . ' ' . $ops[mt_rand(0, 3)] . ' ' . genExpr($depth - 1);
+
+	return mt_rand(0, 2) ? $ret : '(' . $ret . ')';
+}
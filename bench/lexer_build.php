@@ -0,0 +1,47 @@
+<?php
+
+/*
+  Time the lexer state machine construction against the rule count.
+  The rules are keywords followed by a catch all identifier, as in most
+  language lexers, so the start state overlaps every keyword.
+  Usage: php lexer_build.php [max keywords, default 3200]
+ */
+
+use Parle\Lexer;
+use Parle\RLexer;
+use Parle\Token;
+
+$max = isset($argv[1]) ? (int)$argv[1] : 3200;
+
+mt_srand(42);
+$keywords = array();
+while (count($keywords) < $max) {
+	$kw = '';
+	for ($i = 0, $len = mt_rand(3, 10); $i < $len; $i++) {
+		$kw .= chr(mt_rand(ord('a'), ord('z')));
+	}
+	$keywords[$kw] = true;
+}
+$keywords = array_keys($keywords);
+
+echo 'Timing build of keyword lexers:', "\n";
+for ($n = 100; $n <= $max; $n *= 2) {
+	testBuildPerformance(new Lexer, array_slice($keywords, 0, $n));
+	testBuildPerformance(new RLexer, array_slice($keywords, 0, $n));
+	testBuildPerformance(new Lexer, array_slice($keywords, 0, $n), true);
+}
+
+function testBuildPerformance($lex, array $keywords, $fold = false)
+{
+	$startTime = microtime(true);
+	foreach ($keywords as $id => $kw) {
+		$lex->push($kw, $id + 1);
+	}
+	$lex->push("[a-zA-Z_][a-zA-Z_0-9]*", count($keywords) + 1);
+	$lex->push("\\d+", count($keywords) + 2);
+	$lex->push("\\s+", Token::SKIP);
+	$fold ? $lex->build(true) : $lex->build();
+	$endTime = microtime(true);
+
+	echo count($keywords), ' rules took ', $endTime - $startTime, ' seconds (', get_class($lex), $fold ? ', keywords folded' : '', ')', "\n";
+}
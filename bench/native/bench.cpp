@@ -0,0 +1,489 @@
+/*
+  Native benchmarks of the lexer and parser engines, without PHP in the
+  way. Every workload builds a lexer and an LALR parser for one format and
+  runs them over a corpus generated from a fixed seed, so the numbers of
+  two builds are comparable byte for byte:
+
+    build      lexertl and parsertl generator time
+    lex        lexertl::lookup() over the corpus, MB/s and tokens/s
+    parse      parsertl::lookup() steps over a lexer iterator
+    validate   the fused loop of Parser::validate()
+    cvt        UTF-8 to UTF-32 and back as with --enable-parle-utf32
+
+  Every figure is the median of the runs after one warm-up run.
+  Usage: make run, or ./bench [-r runs] [-s corpus MB] [workload ...]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using id_type = uint16_t;
+
+#include "include/lexertl/generator.hpp"
+#include "include/lexertl/iterator.hpp"
+#include "include/parsertl/generator.hpp"
+#include "include/parsertl/lookup.hpp"
+#include "parle/parser/validate.hpp"
+
+/* cvt.hpp expects what parle.cpp sets up for the UTF-32 build. */
+#define PARLE_U32 1
+namespace parle
+{
+	using char_type = char32_t;
+}
+#include "parle/cvt.hpp"
+
+#undef lookup
+
+using lex_rules = lexertl::basic_rules<char, char, id_type>;
+using lex_sm = lexertl::basic_state_machine<char, id_type>;
+using lex_generator = lexertl::basic_generator<lex_rules, lex_sm>;
+using lex_results = lexertl::match_results<const char *, id_type>;
+using lex_iterator = lexertl::iterator<const char *, lex_sm, lex_results>;
+using par_rules = parsertl::basic_rules<char, id_type>;
+using par_sm = parsertl::basic_state_machine<id_type>;
+using par_generator = parsertl::basic_generator<par_rules, par_sm, id_type>;
+using par_results = parsertl::basic_match_results<par_sm>;
+using keywords = parle::lexer::keyword_table<char, id_type>;
+
+using bench_clock = std::chrono::steady_clock;
+
+// A 64 bit LCG, the corpora must not depend on the standard library.
+class rng
+{
+public:
+	explicit rng(uint64_t seed) : _state(seed)
+	{
+	}
+
+	uint32_t next(uint32_t n)
+	{
+		_state = _state * 6364136223846793005ULL + 1442695040888963407ULL;
+		return static_cast<uint32_t>(_state >> 33) % n;
+	}
+
+	const char *pick(const std::vector<const char *> &v)
+	{
+		return v[next(static_cast<uint32_t>(v.size()))];
+	}
+
+private:
+	uint64_t _state;
+};
+
+static const std::vector<const char *> words = {"alpha", "beta", "gamma", "delta", "order", "user", "item", "price",
+	"total", "name", "city", "café", "straße", "count", "value", "state"};
+
+// ASCII only, for identifiers.
+static const std::vector<const char *> names = {"id", "user", "item", "price", "total", "name", "city", "count", "state"};
+
+struct workload
+{
+	const char *name;
+	void (*define)(par_rules &, lex_rules &);
+	void (*emit)(rng &, std::string &);
+};
+
+static void define_csv(par_rules &g, lex_rules &l)
+{
+	g.token("FIELD QUOTED NL");
+	g.push("file", "rows");
+	g.push("rows", "row | rows row");
+	g.push("row", "fields NL");
+	g.push("fields", "field | fields ',' field");
+	g.push("field", "FIELD | QUOTED");
+
+	l.push(R"([^,"\r\n]+)", g.token_id("FIELD"));
+	l.push(R"(\"([^"]|\"\")*\")", g.token_id("QUOTED"));
+	l.push(R"(\r?\n)", g.token_id("NL"));
+	l.push(",", g.token_id("','"));
+}
+
+static void emit_csv(rng &r, std::string &out)
+{
+	out += std::to_string(r.next(1000000));
+	out += ',';
+	out += r.pick(words);
+	out += ",\"";
+	out += r.pick(words);
+	out += ", \"\"";
+	out += r.pick(words);
+	out += "\"\"\",";
+	out += std::to_string(r.next(10000));
+	out += '.';
+	out += std::to_string(r.next(100));
+	out += ',';
+	out += r.pick(words);
+	out += ' ';
+	out += r.pick(words);
+	out += ",2024-0";
+	out += std::to_string(1 + r.next(9));
+	out += "-1";
+	out += std::to_string(r.next(10));
+	out += '\n';
+}
+
+static void define_json(par_rules &g, lex_rules &l)
+{
+	g.token("STRING NUMBER TRUE FALSE NULL");
+	g.push("json", "value");
+	g.push("value", "object | array | STRING | NUMBER | TRUE | FALSE | NULL");
+	g.push("object", "'{' '}' | '{' members '}'");
+	g.push("members", "member | members ',' member");
+	g.push("member", "STRING ':' value");
+	g.push("array", "'[' ']' | '[' elements ']'");
+	g.push("elements", "value | elements ',' value");
+
+	l.push(R"(\"([^"\\]|\\.)*\")", g.token_id("STRING"));
+	l.push(R"(-?(0|[1-9]\d*)(\.\d+)?([eE][-+]?\d+)?)", g.token_id("NUMBER"));
+	l.push("true", g.token_id("TRUE"));
+	l.push("false", g.token_id("FALSE"));
+	l.push("null", g.token_id("NULL"));
+	l.push("[{]", g.token_id("'{'"));
+	l.push("[}]", g.token_id("'}'"));
+	l.push(R"(\[)", g.token_id("'['"));
+	l.push(R"(\])", g.token_id("']'"));
+	l.push(":", g.token_id("':'"));
+	l.push(",", g.token_id("','"));
+	l.push(R"(\s+)", l.skip());
+}
+
+static void emit_json(rng &r, std::string &out)
+{
+	out += out.empty() ? "[\n" : ",\n";
+	out += "\t{\"id\": ";
+	out += std::to_string(r.next(1000000));
+	out += ", \"name\": \"";
+	out += r.pick(words);
+	out += ' ';
+	out += r.pick(words);
+	out += "\", \"score\": ";
+	out += std::to_string(r.next(1000));
+	out += '.';
+	out += std::to_string(r.next(100));
+	out += "e-";
+	out += std::to_string(r.next(4));
+	out += ", \"tags\": [\"";
+	out += r.pick(words);
+	out += "\", \"";
+	out += r.pick(words);
+	out += "\"], \"active\": ";
+	out += r.next(2) ? "true" : "false";
+	out += ", \"parent\": null, \"meta\": {\"x\": -";
+	out += std::to_string(r.next(100));
+	out += ", \"note\": \"say \\\"";
+	out += r.pick(words);
+	out += "\\\"\"}}";
+}
+
+static void define_sql(par_rules &g, lex_rules &l)
+{
+	g.token("SELECT FROM WHERE INSERT INTO VALUES UPDATE SET IDENT NUMBER STRING");
+	g.left("OR");
+	g.left("AND");
+	g.push("script", "stmts");
+	g.push("stmts", "stmt ';' | stmts stmt ';'");
+	g.push("stmt", "select | insert | update");
+	g.push("select", "SELECT cols FROM IDENT | SELECT cols FROM IDENT WHERE cond");
+	g.push("cols", "'*' | ids");
+	g.push("ids", "IDENT | ids ',' IDENT");
+	g.push("cond", "cond AND cond | cond OR cond | '(' cond ')' | IDENT op value");
+	g.push("op", "'=' | '<' | '>'");
+	g.push("value", "IDENT | NUMBER | STRING");
+	g.push("insert", "INSERT INTO IDENT '(' ids ')' VALUES '(' values ')'");
+	g.push("values", "value | values ',' value");
+	g.push("update", "UPDATE IDENT SET assigns WHERE cond");
+	g.push("assigns", "assign | assigns ',' assign");
+	g.push("assign", "IDENT '=' value");
+
+	for (const char *kw : {"SELECT", "FROM", "WHERE", "AND", "OR", "INSERT", "INTO", "VALUES", "UPDATE", "SET"}) {
+		l.push(kw, g.token_id(kw));
+	}
+	l.push(R"([A-Za-z_]\w*)", g.token_id("IDENT"));
+	l.push(R"(\d+)", g.token_id("NUMBER"));
+	l.push("'([^']|'')*'", g.token_id("STRING"));
+	for (const char *op : {"*", ",", "(", ")", "=", "<", ">", ";"}) {
+		l.push(std::string("[") + op + "]", g.token_id(std::string("'") + op + "'"));
+	}
+	l.push(R"(\s+)", l.skip());
+}
+
+static void emit_sql(rng &r, std::string &out)
+{
+	auto cond = [&r, &out]() {
+		out += r.pick(names);
+		out += r.next(2) ? " = " : " > ";
+		out += std::to_string(r.next(1000));
+		if (r.next(2)) {
+			out += r.next(2) ? " AND (" : " OR (";
+			out += r.pick(names);
+			out += " = 'it''s ";
+			out += r.pick(words);
+			out += "')";
+		}
+	};
+
+	switch (r.next(3)) {
+	case 0:
+		out += "SELECT ";
+		out += r.pick(names);
+		out += ", ";
+		out += r.pick(names);
+		out += " FROM ";
+		out += r.pick(names);
+		out += " WHERE ";
+		cond();
+		break;
+	case 1:
+		out += "INSERT INTO ";
+		out += r.pick(names);
+		out += " (id, name) VALUES (";
+		out += std::to_string(r.next(1000));
+		out += ", '";
+		out += r.pick(words);
+		out += "')";
+		break;
+	default:
+		out += "UPDATE ";
+		out += r.pick(names);
+		out += " SET total = ";
+		out += std::to_string(r.next(1000));
+		out += ", name = '";
+		out += r.pick(words);
+		out += "' WHERE ";
+		cond();
+		break;
+	}
+	out += ";\n";
+}
+
+static void define_php(par_rules &g, lex_rules &l)
+{
+	g.token("VAR IDENT NUMBER STRING FUNCTION IF WHILE RETURN ECHO");
+	g.nonassoc("IFX");
+	g.nonassoc("ELSE");
+	g.left("EQ '<' '>'");
+	g.left("'+' '-' '.'");
+	g.left("'*' '/'");
+	g.push("program", "stmts");
+	g.push("stmts", "stmt | stmts stmt");
+	g.push("stmt", "VAR '=' expr ';' | ECHO expr ';' | RETURN expr ';' | expr ';'"
+		" | IF '(' expr ')' block %prec IFX | IF '(' expr ')' block ELSE block"
+		" | WHILE '(' expr ')' block | FUNCTION IDENT '(' params ')' block");
+	g.push("block", "'{' '}' | '{' stmts '}'");
+	g.push("params", "VAR | params ',' VAR");
+	g.push("expr", "expr '+' expr | expr '-' expr | expr '*' expr | expr '/' expr | expr '.' expr"
+		" | expr '<' expr | expr '>' expr | expr EQ expr | '(' expr ')' | VAR | NUMBER | STRING | IDENT '(' args ')'");
+	g.push("args", "expr | args ',' expr");
+
+	l.push("function", g.token_id("FUNCTION"));
+	l.push("if", g.token_id("IF"));
+	l.push("else", g.token_id("ELSE"));
+	l.push("while", g.token_id("WHILE"));
+	l.push("return", g.token_id("RETURN"));
+	l.push("echo", g.token_id("ECHO"));
+	l.push(R"(\$[A-Za-z_]\w*)", g.token_id("VAR"));
+	l.push(R"([A-Za-z_]\w*)", g.token_id("IDENT"));
+	l.push(R"(\d+(\.\d+)?)", g.token_id("NUMBER"));
+	l.push(R"(\"([^"\\]|\\.)*\")", g.token_id("STRING"));
+	l.push("==", g.token_id("EQ"));
+	for (const char *op : {"+", "-", "*", "/", ".", "<", ">", "=", ";", ",", "(", ")", "{", "}"}) {
+		l.push(std::string("[") + op + "]", g.token_id(std::string("'") + op + "'"));
+	}
+	l.push(R"(\/\/[^\n]*)", l.skip());
+	l.push(R"(\s+)", l.skip());
+}
+
+static void emit_php(rng &r, std::string &out)
+{
+	const std::string f = std::string("f_") + r.pick(names);
+
+	out += "// ";
+	out += r.pick(words);
+	out += "\nfunction ";
+	out += f;
+	out += "($a, $b) {\n\t$x = $a + $b * ";
+	out += std::to_string(r.next(100));
+	out += ";\n\tif ($x < ";
+	out += std::to_string(r.next(100));
+	out += ") {\n\t\techo \"";
+	out += r.pick(words);
+	out += "\\n\" . $x;\n\t} else {\n\t\t$x = ";
+	out += f;
+	out += "($x / 2, ($b - 1) * 3) - 1;\n\t}\n\twhile ($x > 0) {\n\t\t$x = $x - ";
+	out += std::to_string(1 + r.next(9));
+	out += ";\n\t}\n\treturn $x == 0;\n}\necho ";
+	out += f;
+	out += "(";
+	out += std::to_string(r.next(1000));
+	out += ", 2.5);\n";
+}
+
+static const workload workloads[] = {
+	{"csv", define_csv, emit_csv},
+	{"json", define_json, emit_json},
+	{"sql", define_sql, emit_sql},
+	{"php", define_php, emit_php},
+};
+
+static std::string corpus(const workload &w, size_t size)
+{
+	rng r(42);
+	std::string out;
+
+	while (out.size() < size) {
+		w.emit(r, out);
+	}
+	if (0 == strcmp("json", w.name)) {
+		out += "\n]\n";
+	}
+
+	return out;
+}
+
+// Median seconds of fn over the runs, after one warm-up run.
+template<typename fn_type>
+double measure(size_t runs, fn_type fn)
+{
+	std::vector<double> times;
+
+	fn();
+	for (size_t i = 0; i < runs; i++) {
+		auto start = bench_clock::now();
+
+		fn();
+		times.push_back(std::chrono::duration<double>(bench_clock::now() - start).count());
+	}
+	std::sort(times.begin(), times.end());
+
+	return times[times.size() / 2];
+}
+
+static void fail(const workload &w, const char *what)
+{
+	fprintf(stderr, "%s: %s\n", w.name, what);
+	exit(1);
+}
+
+static void run(const workload &w, size_t runs, size_t size)
+{
+	par_rules grammar;
+	lex_rules rules;
+	par_sm psm;
+	lex_sm lsm;
+	const keywords kw;
+
+	w.define(grammar, rules);
+
+	const double lex_build = measure(runs, [&]() {
+		lex_generator::build(rules, lsm);
+	});
+	const double par_build = measure(runs, [&]() {
+		par_rules copy = grammar;
+
+		par_generator::build(copy, psm);
+	});
+
+	const std::string in = corpus(w, size);
+	const char *begin = in.c_str(), *end = begin + in.size();
+	const double mb = in.size() / 1e6;
+	size_t tokens = 0, steps = 0;
+
+	const double lex = measure(runs, [&]() {
+		lex_results res(begin, end);
+
+		tokens = 0;
+		while (true) {
+			lexertl::lookup(lsm, res);
+			if (res.first == res.eoi) {
+				break;
+			} else if (res.id == lex_results::npos()) {
+				fail(w, "unknown token");
+			}
+			tokens++;
+		}
+	});
+
+	const double parse = measure(runs, [&]() {
+		lex_iterator iter(begin, end, lsm);
+		par_results res(iter->id, psm);
+
+		steps = 0;
+		while (parsertl::action::error != res.entry.action && parsertl::action::accept != res.entry.action) {
+			parsertl::lookup(iter, psm, res);
+			steps++;
+		}
+		if (parsertl::action::accept != res.entry.action) {
+			fail(w, "corpus does not parse");
+		}
+	});
+
+	const double validate = measure(runs, [&]() {
+		par_results pres;
+		parle::lexer::token_entry<id_type> at;
+		parle::parser::position where;
+
+		if (!parle::parser::validate<lex_results>(lsm, kw, psm, begin, end, pres, at, where)) {
+			fail(w, "corpus does not validate");
+		}
+	});
+
+	std::u32string wide;
+	std::string narrow;
+	const double to32 = measure(runs, [&]() {
+		wide = PARLE_SCVT_U32(in);
+	});
+	const double to8 = measure(runs, [&]() {
+		narrow = PARLE_SCVT_U8(wide);
+	});
+	if (narrow != in) {
+		fail(w, "UTF-32 round trip differs");
+	}
+
+	printf("%-5s %9zu %9zu %9.2f %9.2f %9.1f %9.1f %9.2f %9.1f %9.1f %9.1f %9.1f\n", w.name, in.size(), tokens,
+		lex_build * 1e3, par_build * 1e3, mb / lex, tokens / lex / 1e6, steps / parse / 1e6, mb / parse, mb / validate,
+		mb / to32, mb / to8);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t runs = 7;
+	double size = 4;
+	std::vector<const char *> only;
+
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp("-r", argv[i]) && i + 1 < argc) {
+			runs = std::max(1, atoi(argv[++i]));
+		} else if (0 == strcmp("-s", argv[i]) && i + 1 < argc) {
+			size = std::max(0.01, atof(argv[++i]));
+		} else if ('-' == argv[i][0]) {
+			fprintf(stderr, "Usage: %s [-r runs] [-s corpus MB] [workload ...]\n", argv[0]);
+			return 1;
+		} else {
+			only.push_back(argv[i]);
+		}
+	}
+
+	printf("%zu runs, %.2f MB corpora, medians\n\n", runs, size);
+	printf("%-5s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "", "bytes", "tokens", "lex ms", "par ms", "lex MB/s",
+		"Mtok/s", "Msteps/s", "par MB/s", "val MB/s", "u32 MB/s", "u8 MB/s");
+
+	for (auto &w : workloads) {
+		if (!only.empty() && only.end() == std::find_if(only.begin(), only.end(), [&w](const char *n) { return 0 == strcmp(n, w.name); })) {
+			continue;
+		}
+		try {
+			run(w, runs, static_cast<size_t>(size * 1e6));
+		} catch (const std::exception &e) {
+			fail(w, e.what());
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+<?php
+
+/*
+  Time validate() and the consume()/advance() loop over many short inputs
+  with the same parser, as when checking one expression per request.
+  Usage: php parser_advance.php [inputs, default 20000]
+ */
+
+use Parle\Lexer;
+use Parle\Parser;
+use Parle\RLexer;
+use Parle\RParser;
+use Parle\Token;
+
+$count = isset($argv[1]) ? (int)$argv[1] : 20000;
+
+mt_srand(42);
+$inputs = array();
+for ($i = 0; $i < $count; $i++) {
+	$inputs[] = genExpr(mt_rand(2, 6));
+}
+
+echo 'Timing ', $count, ' expressions:', "\n";
+testParsePerformance(new Parser, new Lexer, $inputs);
+testParsePerformance(new RParser, new RLexer, $inputs);
+
+function genExpr($depth)
+{
+	if ($depth <= 0 || mt_rand(0, 3) == 0) {
+		return (string)mt_rand(0, 1000);
+	}
+	$ops = array('+', '-', '*', '/');
+	$ret = genExpr($depth - 1) . ' ' . $ops[mt_rand(0, 3)] . ' ' . genExpr($depth - 1);
+
+	return mt_rand(0, 2) ? $ret : '(' . $ret . ')';
+}
+
+function testParsePerformance($p, $lex, array $inputs)
+{
+	$p->token("NUM");
+	$p->left("'+' '-'");
+	$p->left("'*' '/'");
+	$p->push("start", "exp");
+	foreach (array('+', '-', '*', '/') as $op) {
+		$p->push("exp", "exp '$op' exp");
+	}
+	$p->push("exp", "'(' exp ')'");
+	$p->push("exp", "NUM");
+	$p->build();
+
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	foreach (array('+', '-', '*', '/', '(', ')') as $op) {
+		$lex->push("\\" . $op, $p->tokenId("'$op'"));
+	}
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	$startTime = microtime(true);
+	foreach ($inputs as $in) {
+		$p->validate($in, $lex);
+	}
+	$validateTime = microtime(true);
+	$reductions = 0;
+	foreach ($inputs as $in) {
+		$p->consume($in, $lex);
+		while ($p::ACTION_ERROR != $p->action && $p::ACTION_ACCEPT != $p->action) {
+			if ($p::ACTION_REDUCE == $p->action) {
+				$reductions++;
+			}
+			$p->advance();
+		}
+	}
+	$endTime = microtime(true);
+
+	echo 'validate() took ', $validateTime - $startTime, ' seconds, advance() loop took ', $endTime - $validateTime, ' seconds for ', $reductions, ' reductions (', get_class($p), ')', "\n";
+}
@@ -0,0 +1,69 @@
+<?php
+
+/*
+  Time the parser table construction for a large synthetic grammar.
+  The grammar is SQL alike, a shared expression sub grammar reachable
+  from many statement kinds, loaded through readBison().
+  Usage: php parser_build.php [statement kinds, default 600]
+ */
+
+use Parle\Parser;
+use Parle\RParser;
+
+$kinds = isset($argv[1]) ? (int)$argv[1] : 600;
+$grammar = genGrammar($kinds);
+
+echo 'Timing build of a grammar with ', $kinds, ' statement kinds:', "\n";
+testBuildPerformance(new Parser, $grammar);
+testBuildPerformance(new RParser, $grammar);
+
+function genGrammar(int $n)
+{
+	$k = function ($i) use ($n) {
+		return "K" . ($i % $n);
+	};
+
+	$out = array();
+	$out[] = "%token ID NUM STR OR AND";
+	$out[] = "%token " . implode(" ", array_map($k, range(0, $n - 1)));
+	$out[] = "%left OR";
+	$out[] = "%left AND";
+	$out[] = "%left '=' '<' '>'";
+	$out[] = "%left '+' '-'";
+	$out[] = "%left '*' '/'";
+	$out[] = "%%";
+	$out[] = "start: stmts;";
+	$out[] = "stmts: stmt | stmts ';' stmt;";
+	$out[] = "expr: expr '+' expr | expr '-' expr | expr '*' expr | expr '/' expr | expr '=' expr"
+		. " | expr '<' expr | expr '>' expr | expr OR expr | expr AND expr | '(' expr ')'"
+		. " | ID | NUM | STR | ID '(' args ')' | ID '.' ID | '[' stmt ']';";
+	$out[] = "args: %empty | arglist;";
+	$out[] = "arglist: expr | arglist ',' expr;";
+
+	$stmts = array();
+	for ($i = 0; $i < $n; $i++) {
+		$stmts[] = "stmt_$i";
+	}
+	$out[] = "stmt: " . implode(" | ", $stmts) . ";";
+
+	for ($i = 0; $i < $n; $i++) {
+		$out[] = "stmt_$i: " . $k($i) . " opt_$i clauses_$i;";
+		$out[] = "clauses_$i: clause_$i | clauses_$i ',' clause_$i;";
+		$out[] = "clause_$i: ID '=' expr | ID " . $k($i + 1) . " expr | " . $k($i + 2) . " '(' arglist ')';";
+		$out[] = "opt_$i: %empty | " . $k($i + 3) . " | " . $k($i + 3) . " NUM;";
+	}
+	$out[] = "%%";
+
+	return implode("\n", $out);
+}
+
+function testBuildPerformance($p, $grammar)
+{
+	$startTime = microtime(true);
+	$p->readBison($grammar);
+	$readTime = microtime(true);
+	$p->build();
+	$endTime = microtime(true);
+
+	echo 'Took ', $readTime - $startTime, ' seconds to read, ', $endTime - $readTime, ' seconds to build (', get_class($p), ')', "\n";
+}
@@ -0,0 +1,146 @@
+<?php
+
+/*
+  Compare the row and the compressed parser table on a large synthetic
+  grammar, the SQL alike one from parser_build.php. Reports the build
+  time, the resident memory growth where /proc is available and the time
+  to validate generated statements.
+  Usage: php parser_compress.php [statement kinds, default 600]
+ */
+
+use Parle\Lexer;
+use Parle\Parser;
+use Parle\Token;
+
+$kinds = isset($argv[1]) ? (int)$argv[1] : 600;
+
+mt_srand(42);
+$inputs = array();
+for ($i = 0; $i < 3000; $i++) {
+	$inputs[] = genStatements($kinds);
+}
+
+echo 'Grammar with ', $kinds, ' statement kinds, ', count($inputs), ' inputs:', "\n";
+foreach (array(0, Parser::COMPRESS_TABLE, Parser::DEFAULT_REDUCTIONS, Parser::DEFAULT_REDUCTIONS | Parser::COMPRESS_TABLE) as $flags) {
+	testTablePerformance($kinds, $flags, $inputs);
+}
+
+function rss()
+{
+	$status = @file_get_contents('/proc/self/status');
+
+	return $status && preg_match('/VmRSS:\s+(\d+)/', $status, $m) ? (int)$m[1] : 0;
+}
+
+function genGrammar(int $n)
+{
+	$k = function ($i) use ($n) {
+		return "K" . ($i % $n);
+	};
+
+	$out = array();
+	$out[] = "%token ID NUM STR OR AND";
+	$out[] = "%token " . implode(" ", array_map($k, range(0, $n - 1)));
+	$out[] = "%left OR";
+	$out[] = "%left AND";
+	$out[] = "%left '=' '<' '>'";
+	$out[] = "%left '+' '-'";
+	$out[] = "%left '*' '/'";
+	$out[] = "%%";
+	$out[] = "start: stmts;";
+	$out[] = "stmts: stmt | stmts ';' stmt;";
+	$out[] = "expr: expr '+' expr | expr '-' expr | expr '*' expr | expr '/' expr | expr '=' expr"
+		. " | expr '<' expr | expr '>' expr | expr OR expr | expr AND expr | '(' expr ')'"
+		. " | ID | NUM | STR | ID '(' args ')' | ID '.' ID | '[' stmt ']';";
+	$out[] = "args: %empty | arglist;";
+	$out[] = "arglist: expr | arglist ',' expr;";
+
+	$stmts = array();
+	for ($i = 0; $i < $n; $i++) {
+		$stmts[] = "stmt_$i";
+	}
+	$out[] = "stmt: " . implode(" | ", $stmts) . ";";
+
+	for ($i = 0; $i < $n; $i++) {
+		$out[] = "stmt_$i: " . $k($i) . " opt_$i clauses_$i;";
+		$out[] = "clauses_$i: clause_$i | clauses_$i ',' clause_$i;";
+		$out[] = "clause_$i: ID '=' expr | ID " . $k($i + 1) . " expr | " . $k($i + 2) . " '(' arglist ')';";
+		$out[] = "opt_$i: %empty | " . $k($i + 3) . " | " . $k($i + 3) . " NUM;";
+	}
+	$out[] = "%%";
+
+	return implode("\n", $out);
+}
+
+function genExpr($depth)
+{
+	if ($depth <= 0 || mt_rand(0, 2) == 0) {
+		$atoms = array('x', '42', 'y.z', 'f(1, 2)');
+		return $atoms[mt_rand(0, 3)];
+	}
+	$ops = array('+', '-', '*', '/', '<', '>', '=');
+
+	return genExpr($depth - 1) . ' ' . $ops[mt_rand(0, 6)] . ' ' . genExpr($depth - 1);
+}
+
+function genStatements($n)
+{
+	$stmts = array();
+	for ($s = mt_rand(1, 4); $s > 0; $s--) {
+		$i = mt_rand(0, $n - 1);
+		$stmt = 'K' . $i;
+		if (mt_rand(0, 1)) {
+			$stmt .= ' K' . (($i + 3) % $n) . (mt_rand(0, 1) ? ' 7' : '');
+		}
+		$clauses = array();
+		for ($c = mt_rand(1, 3); $c > 0; $c--) {
+			switch (mt_rand(0, 2)) {
+			case 0:
+				$clauses[] = 'id = ' . genExpr(3);
+				break;
+			case 1:
+				$clauses[] = 'id K' . (($i + 1) % $n) . ' ' . genExpr(3);
+				break;
+			default:
+				$clauses[] = 'K' . (($i + 2) % $n) . ' (' . genExpr(2) . ', ' . genExpr(2) . ')';
+			}
+		}
+		$stmts[] = $stmt . ' ' . implode(', ', $clauses);
+	}
+
+	return implode('; ', $stmts);
+}
+
+function testTablePerformance($kinds, $flags, array $inputs)
+{
+	$p = new Parser;
+	$p->readBison(genGrammar($kinds));
+
+	$rss = rss();
+	$startTime = microtime(true);
+	$p->build($flags);
+	$buildTime = microtime(true);
+	$rss = rss() - $rss;
+
+	$lex = new Lexer;
+	for ($i = 0; $i < $kinds; $i++) {
+		$lex->push("K$i", $p->tokenId("K$i"));
+	}
+	$lex->push("[a-z]+", $p->tokenId("ID"));
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	foreach (array('+', '-', '*', '/', '<', '>', '=', '(', ')', '[', ']', ',', ';', '.') as $op) {
+		$lex->push("\\" . $op, $p->tokenId("'$op'"));
+	}
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	$valid = 0;
+	$validateTime = microtime(true);
+	foreach ($inputs as $in) {
+		$valid += $p->validate($in, $lex);
+	}
+	$endTime = microtime(true);
+
+	echo 'flags ', $flags, ': build took ', $buildTime - $startTime, ' seconds, +', $rss, ' kB RSS, validate() took ',
+		$endTime - $validateTime, ' seconds, ', $valid, ' valid', "\n";
+}
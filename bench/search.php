@@ -0,0 +1,62 @@
+<?php
+
+/*
+  Time searchAll() finding SQL queries embedded in log lines against
+  preg_match_all() with an equivalent pattern. Both report the same
+  matches with the column list, table and condition as captures.
+  Usage: php search.php [lines, default 100000]
+ */
+
+use Parle\Lexer;
+use Parle\Parser;
+use Parle\RLexer;
+use Parle\RParser;
+use Parle\Token;
+
+$count = isset($argv[1]) ? (int)$argv[1] : 100000;
+
+mt_srand(42);
+$words = array('user', 'request', 'took', 'ms', 'cache', 'miss', 'from', 'node', 'retry', 'select');
+$log = '';
+for ($i = 0; $i < $count; $i++) {
+	$line = mt_rand(1000, 9999) . ' ' . $words[mt_rand(0, 9)] . ' ' . $words[mt_rand(0, 9)] . ' ' . mt_rand(1, 500);
+	if (mt_rand(0, 9) == 0) {
+		$line .= ' query: SELECT id, name FROM users' . (mt_rand(0, 1) ? ' WHERE id = ' . mt_rand(1, 99) : '') . ';';
+	}
+	$log .= $line . "\n";
+}
+
+echo 'Searching ', strlen($log), ' bytes:', "\n";
+
+$startTime = microtime(true);
+$n = preg_match_all('/\bselect\s+([a-z_]+(?:\s*,\s*[a-z_]+)*)\s+from\s+([a-z_]+)(?:\s+where\s+([a-z_]+\s*=\s*\d+))?/i', $log, $m, PREG_OFFSET_CAPTURE);
+$endTime = microtime(true);
+echo 'preg_match_all() took ', $endTime - $startTime, ' seconds for ', $n, ' matches', "\n";
+
+testSearchPerformance(new Parser, new Lexer, $log);
+testSearchPerformance(new RParser, new RLexer, $log);
+
+function testSearchPerformance($p, $lex, $log)
+{
+	$p->token("NAME NUM SELECT FROM WHERE");
+	$p->push("query", "SELECT (cols) FROM (NAME) opt_where");
+	$p->push("cols", "NAME | cols ',' NAME");
+	$p->push("opt_where", "%empty | WHERE (NAME '=' NUM)");
+	$p->build();
+
+	$lex->push("(?i:select)", $p->tokenId("SELECT"));
+	$lex->push("(?i:from)", $p->tokenId("FROM"));
+	$lex->push("(?i:where)", $p->tokenId("WHERE"));
+	$lex->push("[a-zA-Z_]+", $p->tokenId("NAME"));
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	$lex->push(",", $p->tokenId("','"));
+	$lex->push("=", $p->tokenId("'='"));
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	$startTime = microtime(true);
+	$matches = $p->searchAll($log, $lex);
+	$endTime = microtime(true);
+
+	echo 'searchAll() took ', $endTime - $startTime, ' seconds for ', count($matches), ' matches (', get_class($p), ')', "\n";
+}
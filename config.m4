@@ -5,11 +5,14 @@ PHP_ARG_ENABLE(parle, whether to enable parle support,
 [  --enable-parle           Enable lexer/parser support])
 PHP_ARG_ENABLE(parle-utf32, whether to enable internal UTF-32 support in parle,
 [  --enable-parle-utf32     Enable internal UTF-32 support for lexer/parser], no, no)
+PHP_ARG_ENABLE(parle-stats, whether to enable profiling counters in parle,
+[  --enable-parle-stats     Count tokens, parser steps and build phase times], no, no)
 
 if test "$PHP_PARLE" != "no"; then
   PHP_REQUIRE_CXX()
 
   AC_DEFINE(HAVE_PARLE,1,[ ])
+  PHP_ADD_LIBRARY(pthread,, PARLE_SHARED_LIBADD)
   PHP_SUBST(PARLE_SHARED_LIBADD)
 
   PHP_NEW_EXTENSION(parle, parle.cpp, $ext_shared,, -DZEND_ENABLE_STATIC_TSRMLS_CACHE=1 -std=c++14, cxx)
@@ -26,5 +29,10 @@ if test "$PHP_PARLE" != "no"; then
   if test "$PHP_PARLE_UTF32" != "no"; then
     AC_DEFINE(HAVE_PARLE_UTF32,1,[ ])
   fi
+
+  if test "$PHP_PARLE_STATS" != "no"; then
+    AC_DEFINE(HAVE_PARLE_STATS,1,[ ])
+  fi
+
   dnl PHP_INSTALL_HEADERS([ext/parle/php_parle.h])
 fi
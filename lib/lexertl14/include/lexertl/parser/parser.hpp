@@ -211,7 +211,10 @@ namespace lexertl
             using range = typename string_token::range;
             using string_token_vector =
                 std::vector<std::unique_ptr<string_token>>;
-            using token_stack = std::stack<std::unique_ptr<token>>;
+            // Backed by a vector as reduce() makes a local handle for every
+            // reduction, a deque allocates even when left empty.
+            using token_stack = std::stack<std::unique_ptr<token>,
+                std::vector<std::unique_ptr<token>>>;
             using tree_node_stack = typename node::node_stack;
 
             const std::locale& _locale;
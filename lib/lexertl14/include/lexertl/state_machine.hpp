@@ -14,6 +14,7 @@
 #include <set>
 #include "sm_traits.hpp"
 #include "string_token.hpp"
+#include <unordered_map>
 
 namespace lexertl
 {
@@ -111,35 +112,45 @@ namespace lexertl
             index_set index_set_;
             const id_type bol_index_ = dfa_.front();
 
+            // Representative rows by hash, so that every row is only
+            // compared against rows with the same hash instead of against
+            // every later row.
+            std::unordered_map<std::size_t, id_type_vector> rows_;
+
             *lookup_ptr_ = 0;
             // Only one 'jam' state, so skip it.
             first_ += dfa_alphabet_;
 
             for (; first_ < end_; first_ += dfa_alphabet_, ++index_)
             {
-                observer_ptr<const id_type> second_ = first_ + dfa_alphabet_;
+                std::size_t hash_ = 0;
 
-                for (id_type curr_index_ = index_ + 1; second_ < end_;
-                    ++curr_index_, second_ += dfa_alphabet_)
+                for (id_type i_ = 0; i_ < dfa_alphabet_; ++i_)
                 {
-                    if (index_set_.find(curr_index_) != index_set_.end())
-                    {
-                        continue;
-                    }
+                    hash_ = hash_ * 31 + first_[i_];
+                }
 
+                id_type_vector& reps_ = rows_[hash_];
+                bool found_ = false;
+
+                for (const id_type rep_ : reps_)
+                {
                     // Some systems have memcmp in namespace std.
                     using namespace std;
 
-                    if (memcmp(first_, second_, sizeof(id_type) *
-                        dfa_alphabet_) == 0)
+                    if (memcmp(&dfa_.front() + rep_ * dfa_alphabet_, first_,
+                        sizeof(id_type) * dfa_alphabet_) == 0)
                     {
-                        index_set_.insert(curr_index_);
-                        lookup_ptr_[curr_index_] = new_index_;
+                        index_set_.insert(index_);
+                        lookup_ptr_[index_] = lookup_ptr_[rep_];
+                        found_ = true;
+                        break;
                     }
                 }
 
-                if (lookup_ptr_[index_] == npos())
+                if (!found_)
                 {
+                    reps_.push_back(index_);
                     lookup_ptr_[index_] = new_index_;
                     ++new_index_;
                 }
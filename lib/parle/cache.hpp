@@ -0,0 +1,660 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+#ifndef PARLE_CACHE_HPP
+#define PARLE_CACHE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "include/lexertl/enums.hpp"
+#include "include/parsertl/enums.hpp"
+
+namespace parle
+{
+namespace cache
+{
+// Bump on any change of the layout below or of what the tables hold.
+constexpr uint32_t format_version = 4;
+
+// Append one rule definition call to defs. The parts are length prefixed,
+// so the concatenation is unambiguous.
+inline void record(std::string &defs, std::initializer_list<std::string> parts)
+{
+	for (const auto &part : parts) {
+		defs += std::to_string(part.size());
+		defs += ':';
+		defs += part;
+	}
+	defs += '\n';
+}
+
+inline uint64_t hash(const char *pos, const char *end)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	for (; pos != end; ++pos) {
+		h ^= static_cast<unsigned char>(*pos);
+		h *= 1099511628211ULL;
+	}
+
+	return h;
+}
+
+inline uint64_t hash(const std::string &s)
+{
+	return hash(s.data(), s.data() + s.size());
+}
+
+class writer
+{
+public:
+	std::string data;
+
+	template<typename T>
+	void pod(const T &val)
+	{
+		data.append(reinterpret_cast<const char *>(&val), sizeof(T));
+	}
+
+	template<typename A, typename B>
+	void pod(const std::pair<A, B> &val)
+	{
+		pod(val.first);
+		pod(val.second);
+	}
+
+	void size(size_t val)
+	{
+		pod(static_cast<uint64_t>(val));
+	}
+
+	template<typename char_type>
+	void str(const std::basic_string<char_type> &val)
+	{
+		size(val.size());
+		data.append(reinterpret_cast<const char *>(val.data()), val.size() * sizeof(char_type));
+	}
+
+	template<typename T>
+	void vec(const std::vector<T> &val)
+	{
+		size(val.size());
+		items(val, std::is_trivially_copyable<T>());
+	}
+
+private:
+	template<typename T>
+	void items(const std::vector<T> &val, const std::true_type &)
+	{
+		data.append(reinterpret_cast<const char *>(val.data()), val.size() * sizeof(T));
+	}
+
+	template<typename T>
+	void items(const std::vector<T> &val, const std::false_type &)
+	{
+		for (const auto &v : val) {
+			pod(v);
+		}
+	}
+};
+
+// Reads what writer wrote, every read is bounds checked. Once a read
+// fails all the following ones fail, too.
+class reader
+{
+public:
+	reader(const std::string &data) : _pos(data.data()), _end(data.data() + data.size()) {}
+
+	bool ok() const
+	{
+		return nullptr != _pos;
+	}
+
+	bool done() const
+	{
+		return _pos == _end;
+	}
+
+	// Checksum of what is left to read.
+	uint64_t rest_hash() const
+	{
+		return _pos ? hash(_pos, _end) : 0;
+	}
+
+	template<typename T>
+	bool pod(T &val)
+	{
+		if (!take(sizeof(T))) {
+			return false;
+		}
+		memcpy(&val, _pos - sizeof(T), sizeof(T));
+		return true;
+	}
+
+	template<typename A, typename B>
+	bool pod(std::pair<A, B> &val)
+	{
+		return pod(val.first) && pod(val.second);
+	}
+
+	bool size(size_t &val)
+	{
+		uint64_t v = 0;
+
+		if (!pod(v) || v > static_cast<uint64_t>(_end - _pos)) {
+			/* Nothing stored is larger than the remaining bytes. */
+			_pos = nullptr;
+			return false;
+		}
+		val = static_cast<size_t>(v);
+		return true;
+	}
+
+	template<typename char_type>
+	bool str(std::basic_string<char_type> &val)
+	{
+		size_t len;
+
+		if (!size(len) || !take(len * sizeof(char_type))) {
+			return false;
+		}
+		val.resize(len);
+		memcpy(&val[0], _pos - len * sizeof(char_type), len * sizeof(char_type));
+		return true;
+	}
+
+	template<typename T>
+	bool vec(std::vector<T> &val)
+	{
+		size_t len;
+
+		if (!size(len)) {
+			return false;
+		}
+		val.resize(len);
+		return items(val, std::is_trivially_copyable<T>());
+	}
+
+private:
+	const char *_pos;
+	const char *_end;
+
+	template<typename T>
+	bool items(std::vector<T> &val, const std::true_type &)
+	{
+		if (!take(val.size() * sizeof(T))) {
+			return false;
+		}
+		if (!val.empty()) {
+			memcpy(val.data(), _pos - val.size() * sizeof(T), val.size() * sizeof(T));
+		}
+		return true;
+	}
+
+	template<typename T>
+	bool items(std::vector<T> &val, const std::false_type &)
+	{
+		for (auto &v : val) {
+			if (!pod(v)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool take(size_t len)
+	{
+		if (!_pos || len > static_cast<size_t>(_end - _pos)) {
+			_pos = nullptr;
+			return false;
+		}
+		_pos += len;
+		return true;
+	}
+};
+
+// Identifies the file format and the tables layout, the defs are stored
+// in full so a hash collision is a miss and not a wrong table. The
+// checksum of the tables following the header catches a damaged file.
+template<typename char_type, typename id_type>
+void header(writer &w, const std::string &defs)
+{
+	w.data.append("PRLC", 4);
+	w.pod(format_version);
+	w.pod(static_cast<uint8_t>(sizeof(char_type)));
+	w.pod(static_cast<uint8_t>(sizeof(id_type)));
+	w.str(defs);
+}
+
+template<typename char_type, typename id_type>
+std::string seal(const std::string &defs, const writer &tables)
+{
+	writer w;
+
+	header<char_type, id_type>(w, defs);
+	w.pod(hash(tables.data));
+	w.data += tables.data;
+
+	return w.data;
+}
+
+template<typename char_type, typename id_type>
+bool header(reader &r, const std::string &defs)
+{
+	writer expect;
+	std::string got;
+	uint64_t sum = 0;
+
+	header<char_type, id_type>(expect, defs);
+	got.resize(expect.data.size());
+	for (auto &c : got) {
+		if (!r.pod(c)) {
+			return false;
+		}
+	}
+
+	return got == expect.data && r.pod(sum) && sum == r.rest_hash();
+}
+
+// Every index a lookup follows must be in range, so a table that got
+// through the checksum but doesn't fit together is a miss as well.
+template<typename id_type, typename internals_type>
+bool valid_lexer(const internals_type &internals)
+{
+	const size_t dfas = internals._dfa.size();
+	const id_type npos = static_cast<id_type>(~static_cast<id_type>(0));
+	const size_t features = (*lexertl::feature_bit::advance << 1) - 1;
+
+	if (0 == dfas || dfas != internals._lookup.size() || dfas != internals._dfa_alphabet.size() ||
+		0 != (internals._features & ~features)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < dfas; i++) {
+		const size_t alphabet = internals._dfa_alphabet[i];
+		const auto &dfa = internals._dfa[i];
+		const auto &lookup = internals._lookup[i];
+
+		/* The jam state and the start state at least. */
+		if (alphabet <= *lexertl::state_index::transitions || 256 != lookup.size() ||
+			dfa.size() % alphabet || dfa.size() / alphabet < 2) {
+			return false;
+		}
+
+		const size_t rows = dfa.size() / alphabet;
+
+		for (const auto column : lookup) {
+			if (column >= alphabet) {
+				return false;
+			}
+		}
+		/* The bol start state lives in the jam state. */
+		if (dfa[0] >= rows) {
+			return false;
+		}
+		for (size_t row = 0; row < rows; row++) {
+			const id_type *ptr = &dfa[row * alphabet];
+
+			/* Both are npos where a state is popped. */
+			for (const auto dfa_index : {*lexertl::state_index::push_dfa, *lexertl::state_index::next_dfa}) {
+				if (ptr[dfa_index] >= dfas && ptr[dfa_index] != npos) {
+					return false;
+				}
+			}
+			for (size_t col = *lexertl::state_index::eol; col < alphabet; col++) {
+				if (ptr[col] >= rows) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+template<typename sm_type, typename table_type>
+std::string dump_lexer(const std::string &defs, const sm_type &sm, const table_type &keywords)
+{
+	using char_type = typename table_type::string_type::value_type;
+	const auto &data = sm.data();
+	writer w;
+
+	w.pod(data._eoi);
+	w.pod(data._features);
+	w.vec(data._dfa_alphabet);
+	w.size(data._lookup.size());
+	for (const auto &v : data._lookup) {
+		w.vec(v);
+	}
+	w.size(data._dfa.size());
+	for (const auto &v : data._dfa) {
+		w.vec(v);
+	}
+	w.size(keywords.size());
+	for (const auto &e : keywords.entries()) {
+		w.str(e.text);
+		w.pod(e.match_id);
+		w.pod(e.id);
+		w.pod(e.user_id);
+	}
+
+	return seal<char_type, typename sm_type::id_type>(defs, w);
+}
+
+template<typename sm_type, typename table_type>
+bool load_lexer(const std::string &data, const std::string &defs, sm_type &sm, table_type &keywords)
+{
+	using char_type = typename table_type::string_type::value_type;
+	typename sm_type::internals internals;
+	std::vector<typename table_type::entry> entries;
+	reader r(data);
+	size_t n;
+
+	if (!header<char_type, typename sm_type::id_type>(r, defs)) {
+		return false;
+	}
+	r.pod(internals._eoi);
+	r.pod(internals._features);
+	r.vec(internals._dfa_alphabet);
+	if (r.size(n)) {
+		internals._lookup.resize(n);
+		for (auto &v : internals._lookup) {
+			r.vec(v);
+		}
+	}
+	if (r.size(n)) {
+		internals._dfa.resize(n);
+		for (auto &v : internals._dfa) {
+			r.vec(v);
+		}
+	}
+	if (r.size(n)) {
+		entries.resize(n);
+		for (auto &e : entries) {
+			r.str(e.text);
+			r.pod(e.match_id);
+			r.pod(e.id);
+			r.pod(e.user_id);
+		}
+	}
+	if (!r.ok() || !r.done() || !valid_lexer<typename sm_type::id_type>(internals)) {
+		return false;
+	}
+
+	sm.data().swap(internals);
+	keywords.assign(std::move(entries));
+
+	return true;
+}
+
+template<typename char_type, typename sm_type>
+std::string dump_parser(const std::string &defs, const sm_type &sm)
+{
+	writer w;
+
+	w.size(sm._columns);
+	w.size(sm._rows);
+	w.size(sm._rules.size());
+	for (const auto &rule : sm._rules) {
+		w.pod(rule.first);
+		w.vec(rule.second);
+	}
+	w.size(sm._captures.size());
+	for (const auto &capture : sm._captures) {
+		w.size(capture.first);
+		w.vec(capture.second);
+	}
+	w.size(sm._table.size());
+	for (const auto &row : sm._table) {
+		w.size(row.size());
+		for (const auto &cell : row) {
+			w.pod(cell.first);
+			w.pod(static_cast<uint8_t>(cell.second.action));
+			w.pod(cell.second.param);
+		}
+	}
+	w.size(sm._defaults.size());
+	for (const auto &cell : sm._defaults) {
+		w.pod(static_cast<uint8_t>(cell.action));
+		w.pod(cell.param);
+	}
+
+	return seal<char_type, typename sm_type::id_type>(defs, w);
+}
+
+// Same as valid_lexer(), shift and goto lead to a state, reduce to a rule
+// and the symbols are within the columns.
+template<typename sm_type>
+bool valid_parser(const sm_type &sm)
+{
+	const size_t captured = sm._captures.empty() ? 0 : sm._captures.back().first + sm._captures.back().second.size();
+	auto valid = [&sm](const typename sm_type::entry &e) {
+		switch (e.action) {
+		case parsertl::action::error:
+		case parsertl::action::accept:
+			return true;
+		case parsertl::action::shift:
+		case parsertl::action::go_to:
+			return e.param < sm._rows;
+		case parsertl::action::reduce:
+			return e.param < sm._rules.size();
+		}
+		return false;
+	};
+
+	if (0 == sm._rows || sm._table.size() != sm._rows || (!sm._defaults.empty() && sm._defaults.size() != sm._rows)) {
+		return false;
+	}
+	for (const auto &row : sm._table) {
+		for (const auto &cell : row) {
+			if (cell.first >= sm._columns || !valid(cell.second)) {
+				return false;
+			}
+		}
+	}
+	for (const auto &cell : sm._defaults) {
+		if (!valid(cell)) {
+			return false;
+		}
+	}
+	for (const auto &rule : sm._rules) {
+		if (rule.first >= sm._columns) {
+			return false;
+		}
+		for (const auto symbol : rule.second) {
+			if (symbol >= sm._columns) {
+				return false;
+			}
+		}
+	}
+	for (size_t i = 0; i < sm._captures.size(); i++) {
+		const auto &capture = sm._captures[i];
+
+		if (capture.first + capture.second.size() > captured) {
+			return false;
+		}
+		for (const auto &c : capture.second) {
+			/* Positions in the right hand side of the rule reduced. */
+			if (i >= sm._rules.size() || c.first > c.second || c.second >= sm._rules[i].second.size()) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template<typename char_type, typename sm_type>
+bool load_parser(const std::string &data, const std::string &defs, sm_type &sm)
+{
+	sm_type tmp;
+	reader r(data);
+	size_t n;
+
+	if (!header<char_type, typename sm_type::id_type>(r, defs)) {
+		return false;
+	}
+	r.size(tmp._columns);
+	r.size(tmp._rows);
+	if (r.size(n)) {
+		tmp._rules.resize(n);
+		for (auto &rule : tmp._rules) {
+			r.pod(rule.first);
+			r.vec(rule.second);
+		}
+	}
+	if (r.size(n)) {
+		tmp._captures.resize(n);
+		for (auto &capture : tmp._captures) {
+			r.size(capture.first);
+			r.vec(capture.second);
+		}
+	}
+	if (r.size(n)) {
+		tmp._table.resize(n);
+		for (auto &row : tmp._table) {
+			if (!r.size(n)) {
+				break;
+			}
+			row.resize(n);
+			for (auto &cell : row) {
+				uint8_t action = 0;
+
+				r.pod(cell.first);
+				r.pod(action);
+				r.pod(cell.second.param);
+				cell.second.action = static_cast<decltype(cell.second.action)>(action);
+			}
+		}
+	}
+	if (r.size(n)) {
+		tmp._defaults.resize(n);
+		for (auto &cell : tmp._defaults) {
+			uint8_t action = 0;
+
+			r.pod(action);
+			r.pod(cell.param);
+			cell.action = static_cast<decltype(cell.action)>(action);
+		}
+	}
+	if (!r.ok() || !r.done() || !valid_parser(tmp)) {
+		return false;
+	}
+
+	sm.clear();
+	sm._columns = tmp._columns;
+	sm._rows = tmp._rows;
+	sm._rules.swap(tmp._rules);
+	sm._captures.swap(tmp._captures);
+	sm._table.swap(tmp._table);
+	sm._defaults.swap(tmp._defaults);
+
+	return true;
+}
+
+// Cache file for defs of the given kind in dir.
+inline std::string path(const char *dir, const char *kind, const std::string &defs)
+{
+	std::ostringstream ss;
+
+	ss << dir << "/parle-" << kind << "-" << std::hex << hash(defs) << ".bin";
+
+	return ss.str();
+}
+
+inline bool read(const std::string &file, std::string &data)
+{
+	std::ifstream in(file, std::ios::binary);
+
+	if (!in) {
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+	return !in.bad();
+}
+
+// Write to a unique temporary file and rename it into place, so readers
+// in other processes see either no file or a complete one. The cache is
+// best effort, failures are ignored.
+inline void write(const std::string &file, const std::string &data)
+{
+	std::random_device rd;
+	std::ostringstream ss;
+
+	ss << file << ".tmp." << std::hex << rd() << std::hash<std::thread::id>()(std::this_thread::get_id());
+
+	const std::string tmp = ss.str();
+
+	{
+		std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+
+		if (!out) {
+			return;
+		}
+		out.write(data.data(), data.size());
+		out.close();
+		if (!out) {
+			std::remove(tmp.c_str());
+			return;
+		}
+	}
+
+	if (0 != std::rename(tmp.c_str(), file.c_str())) {
+		/* Another process got there first on a platform that doesn't
+			replace on rename, its file is just as good. */
+		std::remove(tmp.c_str());
+	}
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include "include/lexertl/lookup.hpp"
 #include "include/lexertl/runtime_error.hpp"
+#include "parle/stats.hpp"
 
 #undef lookup
 
@@ -14,7 +15,7 @@ namespace parle
 {
 namespace lexer
 {
-template<typename iter, typename sm_type, typename results, typename lexer_obj_type, typename token_cb_type, typename id_type>
+template<typename iter, typename results, typename lexer_obj_type, typename token_cb_type, typename id_type>
 class iterator
 {
 public:
@@ -25,16 +26,25 @@ public:
 	using iterator_category = std::forward_iterator_tag;
 	using cb_map = std::unordered_map<id_type, token_cb_type>;
 
+	// Everything needed to continue lexing from a saved position.
+	struct checkpoint_type
+	{
+		value_type match;
+		size_t line;
+		size_t column;
+		bool done;
+	};
+
 	iterator() :
 		_results(iter(), iter()),
-		_sm(nullptr),
+		_done(true),
 		_lex(nullptr)
 	{
 	}
 
 	iterator(const iter &start_, const iter &end_, lexer_obj_type &lex, bool do_next = false) :
 		_results(start_, end_),
-		_sm(&lex.sm),
+		_done(false),
 		_lex(&lex)
 	{
 
@@ -43,6 +53,27 @@ public:
 		}
 	}
 
+	// Copy of rhs_ for lex, whose input is a copy of the one rhs_ runs over
+	// starting at from_. The positions are moved over to the copy at to_.
+	iterator(const iterator &rhs_, lexer_obj_type &lex, const iter &from_, const iter &to_) :
+		line(rhs_.line),
+		column(rhs_.column),
+		_results(rhs_._results),
+		_done(rhs_._done),
+		_lex(rhs_._lex ? &lex : nullptr)
+	{
+		if (_lex) {
+			rebase(_results, from_, to_);
+		}
+	}
+
+	static void rebase(value_type &results_, const iter &from_, const iter &to_)
+	{
+		results_.first = to_ + (results_.first - from_);
+		results_.second = to_ + (results_.second - from_);
+		results_.eoi = to_ + (results_.eoi - from_);
+	}
+
 	void set_bol(bool bol)
 	{
 		_results.bol = bol;
@@ -58,11 +89,62 @@ public:
 		_results.eoi = end_;
 	}
 
+	// Restart at an arbitrary position, also backwards. The caller supplies
+	// the lexer state and bol flag valid at that position, line and column
+	// are recounted from the beginning of the input. States pushed by a
+	// recursive lexer belong to the old position and are dropped.
+	void restart(const iter &begin_, const iter &start_, const iter &end_, id_type state_, bool bol_)
+	{
+		iter nl = start_;
+		size_t lines = 0;
+
+		for (iter it = begin_; it != start_; ++it) {
+			if (*it == '\n') {
+				lines++;
+				nl = it;
+			}
+		}
+
+		if (bol_) {
+			restart(start_, end_, state_, bol_, lines, 0);
+		} else {
+			restart(start_, end_, state_, bol_, lines, (nl == start_) ? start_ - begin_ : start_ - nl - 1);
+		}
+	}
+
+	// Same as above with line_ and column_ of the token at start_ known,
+	// so nothing is recounted.
+	void restart(const iter &start_, const iter &end_, id_type state_, bool bol_, size_t line_, size_t column_)
+	{
+		_results.reset(start_, end_);
+		_results.state = state_;
+		_results.bol = bol_;
+		_done = false;
+
+		/* The counters are advanced on the next lookup, pre-set them so
+			the token starting at start_ ends up on line_ and column_. */
+		line = bol_ ? line_ - 1 : line_;
+		column = column_;
+	}
+
+	checkpoint_type checkpoint() const
+	{
+		return {_results, line, column, _done};
+	}
+
+	void restore(const checkpoint_type &cp)
+	{
+		_results = cp.match;
+		line = cp.line;
+		column = cp.column;
+		_done = cp.done;
+	}
+
 	// Only need this because of warnings with gcc with -Weffc++
 	iterator(const iterator &rhs_)
 	{
 		_results = rhs_._results;
-		_sm = rhs_._sm;
+		_done = rhs_._done;
 		_lex = rhs_._lex;
 	}
 
@@ -72,7 +154,7 @@ public:
 		if (&rhs_ != this)
 		{
 			_results = rhs_._results;
-			_sm = rhs_._sm;
+			_done = rhs_._done;
 			_lex = rhs_._lex;
 		}
 
@@ -105,7 +187,7 @@ public:
 
 	bool operator ==(const iterator &rhs_) const
 	{
-		return _sm == rhs_._sm && (_sm == nullptr ? true :
+		return _done == rhs_._done && (_done ? true :
 			_results == rhs_._results);
 	}
 
@@ -119,7 +201,9 @@ public:
 	size_t column = SIZE_MAX;
 private:
 	value_type _results;
-	const sm_type *_sm;
+	// Past the end. The tables aren't kept here, they're taken from the
+	// lexer on every lookup, a build replaces them.
+	bool _done;
 	lexer_obj_type *_lex;
 
 	void lookup()
@@ -131,11 +215,14 @@ private:
 			column += _results.second - _results.first;
 		}
 
-		lexertl::lookup(*_sm, _results);
+		lexertl::lookup(_lex->sm(), _results);
+		_lex->keywords().remap(_results);
+		PARLE_STATS(_lex->stats.token(_results.id, _results.second - _results.first));
 
 		if (_lex->cb_map.size() > 0) {
 			auto it = _lex->cb_map.find(_results.id);
 			if (_lex->cb_map.end() != it) {
+				PARLE_STATS(parle::stats::callout_timer timer(_lex->stats));
 				zval result;
 				token_cb_type cb = it->second;
 				zend_fcall_info fci;
@@ -144,7 +231,7 @@ private:
 				if (FAILURE == zend_fcall_info_init(&cb.cb, 0, &fci, &fcc, NULL, NULL)) {
 					zend_throw_exception_ex(ParleLexerException_ce, 0, "Failed to prepare function call");
 					if (_results.first == _results.eoi) {
-						_sm = nullptr;
+						_done = true;
 					}
 					return;
 				}
@@ -155,7 +242,7 @@ private:
 				if (FAILURE == zend_call_function(&fci, &fcc)) {
 					zend_throw_exception_ex(ParleLexerException_ce, 0, "Callback execution failed");
 					if (_results.first == _results.eoi) {
-						_sm = nullptr;
+						_done = true;
 					}
 					return;
 				}
@@ -163,14 +250,14 @@ private:
 #if 0
 				convert_to_boolean(&result);
 				if (Z_TYPE(result) == IS_FALSE && _results.first != _results.eoi) {
-					lexertl::lookup(*_sm, _results);
+					lexertl::lookup(_lex->sm(), _results);
 				}
 #endif
 			}
 		}
 
 		if (_results.first == _results.eoi) {
-			_sm = nullptr;
+			_done = true;
 		}
 	}
 };
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+#ifndef PARLE_LEXER_KEYWORDS_HPP
+#define PARLE_LEXER_KEYWORDS_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "include/lexertl/generator.hpp"
+#include "include/lexertl/lookup.hpp"
+#include "parle/memory.hpp"
+
+#undef lookup
+
+namespace parle
+{
+namespace lexer
+{
+// Literal rules folded out of the state machine. The rule matching the
+// literal in the folded machine, usually the identifier rule, reports its
+// own id and it is remapped here after the match. Open addressing with
+// linear probing over a table at most half full, so a lookup is one hash
+// of the lexeme and mostly a single compare.
+template<typename char_type, typename id_type>
+class keyword_table
+{
+public:
+	using string_type = std::basic_string<char_type>;
+
+	struct entry
+	{
+		string_type text;
+		id_type match_id;
+		id_type id;
+		id_type user_id;
+	};
+
+	bool empty() const
+	{
+		return _entries.empty();
+	}
+
+	size_t size() const
+	{
+		return _entries.size();
+	}
+
+	const std::vector<entry> &entries() const
+	{
+		return _entries;
+	}
+
+	// Heap bytes of the entries and the slots.
+	size_t memory() const
+	{
+		size_t ret = memory::heap(_slots) + _entries.capacity() * sizeof(entry);
+
+		for (auto &e : _entries) {
+			ret += memory::heap(e.text);
+		}
+
+		return ret;
+	}
+
+	void clear()
+	{
+		_entries.clear();
+		_slots.clear();
+		_mask = 0;
+	}
+
+	void assign(std::vector<entry> &&entries)
+	{
+		size_t size = 16;
+
+		while (size < entries.size() * 2) {
+			size *= 2;
+		}
+
+		_entries = std::move(entries);
+		_slots.assign(size, 0);
+		_mask = size - 1;
+
+		for (size_t i = 0; i < _entries.size(); i++) {
+			const string_type &text = _entries[i].text;
+			size_t slot = hash(text.cbegin(), text.cend()) & _mask;
+
+			while (_slots[slot]) {
+				slot = (slot + 1) & _mask;
+			}
+			_slots[slot] = i + 1;
+		}
+	}
+
+	template<typename results>
+	void remap(results &res) const
+	{
+		if (_entries.empty() || res.first == res.eoi) {
+			return;
+		}
+
+		const size_t len = res.second - res.first;
+
+		for (size_t slot = hash(res.first, res.second) & _mask; _slots[slot]; slot = (slot + 1) & _mask) {
+			const entry &e = _entries[_slots[slot] - 1];
+
+			if (e.match_id == res.id && e.text.size() == len && std::equal(e.text.cbegin(), e.text.cend(), res.first)) {
+				res.id = e.id;
+				res.user_id = e.user_id;
+				break;
+			}
+		}
+	}
+
+private:
+	std::vector<entry> _entries;
+	std::vector<size_t> _slots;
+	size_t _mask = 0;
+
+	template<typename iter>
+	static size_t hash(iter first, const iter &second)
+	{
+		size_t h = 14695981039346656037ULL;
+
+		for (; first != second; ++first) {
+			h ^= static_cast<size_t>(*first);
+			h *= 1099511628211ULL;
+		}
+
+		return h;
+	}
+};
+
+// The text a regex matches if it matches exactly one, else false. Quoted
+// strings and escaped punctuation count as text, escaped letters and
+// digits are classes or codes and whitespace may be skipped by the flags.
+template<typename string_type>
+bool literal_text(const string_type &regex, string_type &text)
+{
+	static const char meta[] = ".*+?|(){}[]^$/";
+	auto ascii = [](unsigned long c) {
+		return c < 0x80 ? static_cast<int>(c) : 0;
+	};
+	bool quoted = false;
+
+	text.clear();
+	for (auto it = regex.cbegin(), end = regex.cend(); it != end; ++it) {
+		auto c = *it;
+
+		if ('\\' == c) {
+			if (++it == end || isalnum(ascii(*it))) {
+				return false;
+			}
+			text += *it;
+		} else if ('"' == c) {
+			quoted = !quoted;
+		} else if (isspace(ascii(c))) {
+			return false;
+		} else if (!quoted && ascii(c) && std::find(meta, meta + sizeof(meta) - 1, ascii(c)) != meta + sizeof(meta) - 1) {
+			return false;
+		} else {
+			text += c;
+		}
+	}
+
+	return !quoted && !text.empty();
+}
+
+// Build the state machine with the literal rules that a later rule also
+// matches in full folded into keywords. Which rule matches a literal is
+// found with a state machine of the remaining rules, so rule order and
+// longest match work out the same as without folding. Returns false and
+// leaves sm alone if nothing can be folded, also if case insensitive
+// matching or anchors are involved.
+template<typename generator, typename results, typename rules_type, typename rule_vector, typename sm_type, typename table_type>
+bool build_folded(const rules_type &rules, const rule_vector &pushed, sm_type &sm, table_type &keywords)
+{
+	using id_type = typename sm_type::id_type;
+	using string_type = typename table_type::string_type;
+	std::vector<string_type> texts(pushed.size());
+	std::vector<char> literal(pushed.size()), folded(pushed.size(), 0);
+	std::vector<typename table_type::entry> entries;
+	std::set<string_type> seen;
+
+	if ((rules.flags() & *lexertl::regex_flags::icase) || pushed.size() >= static_cast<size_t>(rules_type::skip() - 1)) {
+		return false;
+	}
+
+	rules_type check = rules;
+	sm_type check_sm;
+
+	check.clear(0);
+	for (size_t i = 0; i < pushed.size(); i++) {
+		literal[i] = literal_text(pushed[i].regex, texts[i]);
+		if (!literal[i]) {
+			check.push(pushed[i].regex.c_str(), static_cast<id_type>(i + 1));
+		}
+	}
+	if (check.features()[0] & (*lexertl::feature_bit::bol | *lexertl::feature_bit::eol)) {
+		return false;
+	}
+	generator::build(check, check_sm);
+	if (check_sm.empty()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < pushed.size(); i++) {
+		if (!literal[i] || 0 == pushed[i].id || rules_type::skip() == pushed[i].id) {
+			continue;
+		}
+
+		/* An earlier folded literal with the same text already wins. */
+		if (seen.count(texts[i])) {
+			folded[i] = 1;
+			continue;
+		}
+
+		results m(texts[i].cbegin(), texts[i].cend());
+
+		lexertl::lookup(check_sm, m);
+		if (m.second != texts[i].cend() || 0 == m.id || m.id > pushed.size()) {
+			continue;
+		}
+
+		auto &match = pushed[m.id - 1];
+
+		if (static_cast<size_t>(m.id - 1) < i || 0 == match.id || rules_type::skip() == match.id) {
+			continue;
+		}
+
+		folded[i] = 1;
+		seen.insert(texts[i]);
+		entries.push_back({texts[i], match.id, pushed[i].id, pushed[i].user_id});
+	}
+
+	if (entries.empty()) {
+		return false;
+	}
+
+	rules_type out = rules;
+
+	out.clear(0);
+	for (size_t i = 0; i < pushed.size(); i++) {
+		if (!folded[i]) {
+			out.push(pushed[i].regex.c_str(), pushed[i].id, pushed[i].user_id);
+		}
+	}
+	generator::build(out, sm);
+	keywords.assign(std::move(entries));
+
+	return true;
+}
+
+// lexertl::lookup() followed by the keyword remap.
+template<typename sm_type, typename results, typename table_type>
+void lookup(const sm_type &sm, results &res, const table_type &keywords)
+{
+	lexertl::lookup(sm, res);
+	keywords.remap(res);
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
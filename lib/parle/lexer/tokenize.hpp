@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+#ifndef PARLE_LEXER_TOKENIZE_HPP
+#define PARLE_LEXER_TOKENIZE_HPP
+
+#include <exception>
+#include <utility>
+#include <thread>
+#include <vector>
+#include "include/lexertl/lookup.hpp"
+#include "parle/lexer/keywords.hpp"
+
+#undef lookup
+
+namespace parle
+{
+namespace lexer
+{
+// Chunks smaller than this aren't worth a thread.
+constexpr size_t tokenize_min_chunk = 64 * 1024;
+
+template<typename id_type>
+struct token_span
+{
+	id_type id;
+	size_t first;
+	size_t second;
+};
+
+// Like lexertl::replace(), but with a replacement per token id. Tokens
+// without one as well as skipped and unknown input are passed through, out
+// gets the spans of [begin, end) in between and the replacements in order.
+// Callouts are not involved.
+template<typename results, typename sm_type, typename table_type, typename iter, typename map_type, typename out_type>
+void replace(const sm_type &sm, const table_type &keywords, const iter &begin, const iter &end, const map_type &replacements, out_type &out)
+{
+	results res(begin, end);
+	iter last = begin;
+
+	while (true) {
+		lookup(sm, res, keywords);
+		if (res.first == res.eoi) {
+			break;
+		}
+
+		const auto it = replacements.find(res.id);
+
+		if (it != replacements.end()) {
+			out.append(last, res.first);
+			out.append(it->second);
+			last = res.second;
+		}
+	}
+	out.append(last, end);
+}
+
+// Find the chunk boundaries, the finder returns the first safe position
+// at or after the one passed. Boundaries are ascending and unique.
+template<typename iter, typename finder_type>
+std::vector<iter> split(const iter &begin, const iter &end, size_t chunks, finder_type finder)
+{
+	std::vector<iter> ret{begin};
+	const size_t len = end - begin;
+
+	for (size_t i = 1; i < chunks; i++) {
+		iter pos = begin + len / chunks * i;
+
+		if (pos <= ret.back()) {
+			pos = ret.back() + 1;
+		}
+		if (pos >= end) {
+			break;
+		}
+		pos = finder(pos);
+		if (pos >= end) {
+			break;
+		}
+		ret.push_back(pos);
+	}
+	ret.push_back(end);
+
+	return ret;
+}
+
+// Run fn(i) for every chunk, chunk 0 on the calling thread. The first
+// exception thrown by a worker is rethrown after all of them are joined.
+template<typename fn_type>
+void parallel_for(size_t chunks, fn_type fn)
+{
+	std::vector<std::exception_ptr> errors(chunks);
+	std::vector<std::thread> workers;
+
+	auto work = [&](size_t i) {
+		try {
+			fn(i);
+		} catch (...) {
+			errors[i] = std::current_exception();
+		}
+	};
+
+	for (size_t i = 1; i < chunks; i++) {
+		workers.emplace_back(work, i);
+	}
+	work(0);
+	for (auto &w : workers) {
+		w.join();
+	}
+
+	for (auto &e : errors) {
+		if (e) {
+			std::rethrow_exception(e);
+		}
+	}
+}
+
+// The lexer state a lookup starts with. Two lookups with equal entries
+// produce the same tokens from there on. The recursive lexer also carries
+// a stack, entries only compare equal while it is empty on both sides.
+template<typename id_type>
+struct token_entry
+{
+	size_t pos;
+	id_type state;
+	bool bol;
+	size_t depth;
+
+	bool operator ==(const token_entry &rhs) const
+	{
+		return pos == rhs.pos && state == rhs.state && bol == rhs.bol && 0 == depth && 0 == rhs.depth;
+	}
+};
+
+template<typename results>
+size_t entry_depth(const results &)
+{
+	return 0;
+}
+
+template<typename iter, typename id_type, std::size_t flags>
+size_t entry_depth(const lexertl::recursive_match_results<iter, id_type, flags> &res)
+{
+	return res.stack.size();
+}
+
+template<typename results, typename iter>
+token_entry<typename results::id_type> entry_of(const results &res, const iter &begin)
+{
+	return {static_cast<size_t>(res.second - begin), res.state, res.bol, entry_depth(res)};
+}
+
+template<typename results>
+struct speculative_chunk
+{
+	using id_type = typename results::id_type;
+
+	std::vector<token_span<id_type>> tokens;
+	std::vector<token_entry<id_type>> entries;
+	results last;
+	bool eoi = false;
+};
+
+// Lex from res until a lookup would start at or after stop. The tokens
+// may run past stop, the state reached is left in res.
+template<typename sm_type, typename table_type, typename results, typename iter>
+void speculate_range(const sm_type &sm, const table_type &keywords, const iter &begin, const iter &stop, results &res, speculative_chunk<results> &out)
+{
+	while (res.second < stop) {
+		auto entry = entry_of(res, begin);
+
+		lookup(sm, res, keywords);
+		if (res.first == res.eoi) {
+			out.eoi = true;
+			break;
+		}
+		out.entries.push_back(entry);
+		out.tokens.push_back({res.id, static_cast<size_t>(res.first - begin), static_cast<size_t>(res.second - begin)});
+	}
+}
+
+// Lex the chunks between the boundaries on separate threads, every chunk
+// from the INITIAL state. The chunks are then stitched together in order.
+// Once the true state at the end of the previous chunk coincides with an
+// entry the chunk passed through, the rest of that chunk is taken as is.
+// Otherwise the chunk is lexed again from the true state until both runs
+// converge, so the output is the same as with a sequential run. Boundaries
+// where the lexer is in the INITIAL state converge right away, others cost
+// a sequential run up to the next such position.
+template<typename results, typename sm_type, typename table_type, typename iter>
+std::vector<token_span<typename sm_type::id_type>> tokenize(const sm_type &sm, const table_type &keywords, const std::vector<iter> &bounds)
+{
+	const size_t chunks = bounds.size() - 1;
+	const iter &begin = bounds.front(), &end = bounds.back();
+	std::vector<speculative_chunk<results>> parts(chunks);
+	std::vector<token_span<typename sm_type::id_type>> ret;
+
+	parallel_for(chunks, [&](size_t i) {
+		const iter &start = bounds[i];
+		auto &part = parts[i];
+
+		part.last = results(start, end, start == begin || '\n' == *(start - 1));
+		speculate_range(sm, keywords, begin, bounds[i + 1], part.last, part);
+	});
+
+	results res = parts[0].last;
+	bool eoi = parts[0].eoi;
+
+	ret = std::move(parts[0].tokens);
+	for (size_t i = 1; i < chunks && !eoi; i++) {
+		auto &part = parts[i];
+		const iter &stop = bounds[i + 1];
+		size_t j = 0;
+
+		while (res.second < stop) {
+			auto entry = entry_of(res, begin);
+
+			while (j < part.entries.size() && part.entries[j].pos < entry.pos) {
+				j++;
+			}
+			if (j < part.entries.size() && part.entries[j] == entry) {
+				/* Converged, the remaining tokens of the chunk are valid. */
+				ret.insert(ret.end(), part.tokens.begin() + j, part.tokens.end());
+				res = part.last;
+				eoi = part.eoi;
+				break;
+			}
+
+			lookup(sm, res, keywords);
+			if (res.first == res.eoi) {
+				eoi = true;
+				break;
+			}
+			ret.push_back({res.id, static_cast<size_t>(res.first - begin), static_cast<size_t>(res.second - begin)});
+		}
+	}
+
+	return ret;
+}
+
+// Split at arbitrary positions, there are no safe split points. The chunks
+// are lexed speculatively and fixed up by the stitching in tokenize().
+template<typename results, typename sm_type, typename table_type, typename iter>
+std::vector<token_span<typename sm_type::id_type>> tokenize_speculative(const sm_type &sm, const table_type &keywords, const iter &begin, const iter &end, size_t chunks)
+{
+	const size_t len = end - begin;
+	std::vector<iter> bounds;
+
+	for (size_t i = 0; i < chunks; i++) {
+		bounds.push_back(begin + len / chunks * i);
+	}
+	bounds.push_back(end);
+
+	return tokenize<results>(sm, keywords, bounds);
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
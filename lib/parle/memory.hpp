@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+#ifndef PARLE_MEMORY_HPP
+#define PARLE_MEMORY_HPP
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "include/lexertl/parser/tokeniser/re_token.hpp"
+
+namespace parle
+{
+namespace memory
+{
+// What the nodes of the tree and hash containers add to their value, as
+// with libstdc++ and libc++ on 64 bit. The figures are estimates from the
+// container capacities, the allocator may round up.
+constexpr std::size_t tree_node = 4 * sizeof(void *);
+constexpr std::size_t hash_node = 2 * sizeof(void *);
+
+// Heap bytes owned by a value, not counting the value itself.
+template<typename type>
+std::size_t heap(const type &)
+{
+	return 0;
+}
+
+template<typename char_type, typename traits, typename alloc>
+std::size_t heap(const std::basic_string<char_type, traits, alloc> &s);
+template<typename type, typename alloc>
+std::size_t heap(const std::vector<type, alloc> &v);
+template<typename alloc>
+std::size_t heap(const std::vector<bool, alloc> &v);
+template<typename first_type, typename second_type>
+std::size_t heap(const std::pair<first_type, second_type> &p);
+template<typename key_type, typename value_type, typename compare, typename alloc>
+std::size_t heap(const std::map<key_type, value_type, compare, alloc> &m);
+template<typename key_type, typename compare, typename alloc>
+std::size_t heap(const std::set<key_type, compare, alloc> &s);
+template<typename key_type, typename value_type, typename hash, typename equal, typename alloc>
+std::size_t heap(const std::unordered_map<key_type, value_type, hash, equal, alloc> &m);
+template<typename rules_char_type, typename char_type>
+std::size_t heap(const lexertl::detail::basic_re_token<rules_char_type, char_type> &t);
+
+template<typename char_type, typename traits, typename alloc>
+std::size_t heap(const std::basic_string<char_type, traits, alloc> &s)
+{
+	const char *data = reinterpret_cast<const char *>(s.data());
+	const char *self = reinterpret_cast<const char *>(&s);
+
+	/* Short strings live in the object. */
+	if (data >= self && data < self + sizeof(s)) {
+		return 0;
+	}
+
+	return (s.capacity() + 1) * sizeof(char_type);
+}
+
+template<typename type, typename alloc>
+std::size_t heap(const std::vector<type, alloc> &v)
+{
+	std::size_t ret = v.capacity() * sizeof(type);
+
+	for (const auto &e : v) {
+		ret += heap(e);
+	}
+
+	return ret;
+}
+
+template<typename alloc>
+std::size_t heap(const std::vector<bool, alloc> &v)
+{
+	return (v.capacity() + 7) / 8;
+}
+
+template<typename first_type, typename second_type>
+std::size_t heap(const std::pair<first_type, second_type> &p)
+{
+	return heap(p.first) + heap(p.second);
+}
+
+template<typename key_type, typename value_type, typename compare, typename alloc>
+std::size_t heap(const std::map<key_type, value_type, compare, alloc> &m)
+{
+	std::size_t ret = m.size() * (tree_node + sizeof(typename std::map<key_type, value_type, compare, alloc>::value_type));
+
+	for (const auto &e : m) {
+		ret += heap(e.first) + heap(e.second);
+	}
+
+	return ret;
+}
+
+template<typename key_type, typename compare, typename alloc>
+std::size_t heap(const std::set<key_type, compare, alloc> &s)
+{
+	std::size_t ret = s.size() * (tree_node + sizeof(key_type));
+
+	for (const auto &e : s) {
+		ret += heap(e);
+	}
+
+	return ret;
+}
+
+template<typename key_type, typename value_type, typename hash, typename equal, typename alloc>
+std::size_t heap(const std::unordered_map<key_type, value_type, hash, equal, alloc> &m)
+{
+	std::size_t ret = m.bucket_count() * sizeof(void *) +
+		m.size() * (hash_node + sizeof(typename std::unordered_map<key_type, value_type, hash, equal, alloc>::value_type));
+
+	for (const auto &e : m) {
+		ret += heap(e.first) + heap(e.second);
+	}
+
+	return ret;
+}
+
+template<typename rules_char_type, typename char_type>
+std::size_t heap(const lexertl::detail::basic_re_token<rules_char_type, char_type> &t)
+{
+	return heap(t._extra) + heap(t._str._ranges);
+}
+
+// The parsed regexes and per rule tables of lexertl rules. Macros and
+// state names are left out, there is no access to them.
+template<typename rules_type>
+std::size_t lexer_rules(const rules_type &rules)
+{
+	return heap(rules.statemap()) + heap(rules.regexes()) + heap(rules.features()) + heap(rules.ids()) +
+		heap(rules.user_ids()) + heap(rules.next_dfas()) + heap(rules.pushes()) + heap(rules.pops());
+}
+
+// The transition rows of all lexer states.
+template<typename sm_type>
+std::size_t lexer_dfa(const sm_type &sm)
+{
+	return heap(sm.data()._dfa) + heap(sm.data()._dfa_alphabet);
+}
+
+// The char to equivalence class tables, one per lexer state.
+template<typename sm_type>
+std::size_t lexer_lookup(const sm_type &sm)
+{
+	return heap(sm.data()._lookup);
+}
+
+// The grammar, the symbol names and everything parsertl keeps to build.
+// The lexers parsing the rule strings are static, shared by all.
+template<typename rules_type>
+std::size_t parser_rules(const rules_type &rules)
+{
+	std::vector<typename rules_type::string> symbols;
+	std::size_t ret = rules.grammar().capacity() * sizeof(typename rules_type::production_vector::value_type);
+
+	for (const auto &p : rules.grammar()) {
+		ret += heap(p._rhs.first) + heap(p._rhs.second);
+	}
+	ret += heap(rules.tokens_info()) + heap(rules.nt_locations()) + heap(rules.captures());
+
+	/* Both name maps, string to id. */
+	rules.symbols(symbols);
+	for (const auto &name : symbols) {
+		ret += tree_node + sizeof(typename rules_type::string_id_type_map::value_type) + heap(name);
+	}
+
+	return ret;
+}
+
+// The action table in either form, the default reductions and the rule
+// lengths the parser needs to reduce.
+template<typename sm_type>
+std::size_t parser_table(const sm_type &sm)
+{
+	return heap(sm._table) + heap(sm._defaults) + heap(sm._base) + heap(sm._next) + heap(sm._check) +
+		heap(sm._rules) + heap(sm._captures);
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
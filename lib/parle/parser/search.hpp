@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+
+#ifndef PARLE_PARSER_SEARCH_HPP
+#define PARLE_PARSER_SEARCH_HPP
+
+#include <utility>
+#include <vector>
+#include "include/parsertl/enums.hpp"
+#include "parle/lexer/keywords.hpp"
+#include "parle/lexer/tokenize.hpp"
+#include "parle/parser/validate.hpp"
+
+#undef lookup
+
+namespace parle
+{
+namespace parser
+{
+// Spans of a match as offsets from the beginning of the input. The first
+// entry holds the whole match. The others hold a span for every time the
+// rule with that capture was reduced, so there may be several or none.
+using capture_spans = std::vector<std::vector<std::pair<size_t, size_t>>>;
+
+// The tokens of the input, lexed on demand from the INITIAL state. The
+// search goes back to earlier tokens when a match fails, the ones before
+// release() are dropped eventually.
+template<typename results, typename sm_type, typename table_type, typename iter>
+class token_stream
+{
+public:
+	using token = lexer::token_span<typename sm_type::id_type>;
+
+	token_stream(const sm_type &sm, const table_type &keywords, const iter &begin, const iter &end) :
+		_sm(sm),
+		_keywords(keywords),
+		_begin(begin),
+		_res(begin, end)
+	{
+	}
+
+	static typename sm_type::id_type npos()
+	{
+		return results::npos();
+	}
+
+	// The token at index i, past the end of the input this is EOI.
+	const token &operator [](const size_t i)
+	{
+		while (!_eoi && i >= _base + _tokens.size()) {
+			lexer::lookup(_sm, _res, _keywords);
+			_eoi = _res.first == _res.eoi;
+			_tokens.push_back({_res.id, static_cast<size_t>(_res.first - _begin), static_cast<size_t>(_res.second - _begin)});
+		}
+
+		return i < _base + _tokens.size() ? _tokens[i - _base] : _tokens.back();
+	}
+
+	void release(const size_t i)
+	{
+		const size_t n = i - _base;
+
+		if (n > 4096 && n > _tokens.size() / 2) {
+			_tokens.erase(_tokens.begin(), _tokens.begin() + n);
+			_base = i;
+		}
+	}
+
+private:
+	const sm_type &_sm;
+	const table_type &_keywords;
+	const iter _begin;
+	results _res;
+	std::vector<token> _tokens;
+	size_t _base = 0;
+	bool _eoi = false;
+};
+
+// The longest run of tokens from index first on the grammar accepts as
+// a whole, returns the index past its last token or first if there's
+// none. After every shift the stack is checked for whether EOI would be
+// accepted there, the parse goes on until the first error.
+template<typename par_sm_type, typename stream_type>
+size_t match_at(const par_sm_type &psm, stream_type &tokens, const size_t first, std::vector<typename par_sm_type::id_type> &stack,
+	std::vector<typename par_sm_type::id_type> &scratch)
+{
+	using id_type = typename par_sm_type::id_type;
+	using entry_type = typename par_sm_type::entry;
+	size_t i = first, ret = first;
+	entry_type entry;
+
+	auto lookahead = [&]() {
+		const auto id = tokens[i].id;
+
+		if (id == stream_type::npos()) {
+			entry.action = parsertl::action::error;
+			entry.param = static_cast<id_type>(parsertl::error_type::unknown_token);
+		} else {
+			entry = psm.at(stack.back(), id);
+		}
+	};
+
+	stack.clear();
+	stack.push_back(0);
+	lookahead();
+
+	while (true) {
+		switch (entry.action) {
+		case parsertl::action::shift:
+			if (0 == tokens[i].id) {
+				return ret;
+			}
+			stack.push_back(entry.param);
+			++i;
+			if (parsertl::action::error != psm.at(entry.param, 0).action) {
+				scratch = stack;
+				if (accepts(psm, scratch, 0)) {
+					ret = i;
+				}
+			}
+			lookahead();
+			break;
+		case parsertl::action::reduce:
+		{
+			const auto &rule = psm._rules[entry.param];
+
+			stack.resize(stack.size() - rule.second.size());
+			entry = psm.at(stack.back(), rule.first);
+			break;
+		}
+		case parsertl::action::go_to:
+			stack.push_back(entry.param);
+			lookahead();
+			break;
+		default:
+			return ret;
+		}
+	}
+}
+
+// Parse the tokens [first, last) again, followed by EOI, and collect the
+// spans of the captures as their rules are reduced.
+template<typename par_sm_type, typename stream_type>
+void capture(const par_sm_type &psm, stream_type &tokens, const size_t first, const size_t last, std::vector<typename par_sm_type::id_type> &stack,
+	std::vector<std::pair<size_t, size_t>> &productions, capture_spans &out)
+{
+	using entry_type = typename par_sm_type::entry;
+	size_t i = first;
+	entry_type entry;
+
+	auto id = [&]() {
+		return i < last ? tokens[i].id : 0;
+	};
+
+	out.clear();
+	out.resize((psm._captures.empty() ? 0 : psm._captures.back().first + psm._captures.back().second.size()) + 1);
+	out[0].emplace_back(tokens[first].first, tokens[last - 1].second);
+	stack.clear();
+	stack.push_back(0);
+	productions.clear();
+	entry = psm.at(0, id());
+
+	while (true) {
+		switch (entry.action) {
+		case parsertl::action::shift:
+			stack.push_back(entry.param);
+			productions.emplace_back(tokens[i].first, tokens[i].second);
+			++i;
+			entry = psm.at(entry.param, id());
+			break;
+		case parsertl::action::reduce:
+		{
+			const auto &rule = psm._rules[entry.param];
+			const size_t size = rule.second.size();
+			std::pair<size_t, size_t> span;
+
+			if (size) {
+				const size_t base = productions.size() - size;
+
+				if (entry.param < psm._captures.size()) {
+					const auto &row = psm._captures[entry.param];
+					size_t index = row.first + 1;
+
+					for (const auto &c : row.second) {
+						out[index++].emplace_back(productions[base + c.first].first, productions[base + c.second].second);
+					}
+				}
+
+				span = {productions[base].first, productions.back().second};
+				stack.resize(stack.size() - size);
+				productions.resize(base);
+			} else {
+				const size_t pos = productions.empty() ? tokens[first].first : productions.back().second;
+
+				span = {pos, pos};
+			}
+
+			productions.push_back(span);
+			entry = psm.at(stack.back(), rule.first);
+			break;
+		}
+		case parsertl::action::go_to:
+			stack.push_back(entry.param);
+			entry = psm.at(entry.param, id());
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+// Find the grammar's matches in [begin, end), the same way as
+// parsertl::search(). Every token is tried as the start of a match, the
+// longest one wins and the next search starts past it. Empty matches are
+// not reported. fn is passed the captures of every match and returns
+// whether to go on. Callouts are not involved.
+template<typename results, typename lex_sm_type, typename table_type, typename par_sm_type, typename iter, typename fn_type>
+void search(const lex_sm_type &lsm, const table_type &keywords, const par_sm_type &psm, const iter &begin, const iter &end, fn_type fn)
+{
+	token_stream<results, lex_sm_type, table_type, iter> tokens(lsm, keywords, begin, end);
+	std::vector<typename par_sm_type::id_type> stack, scratch;
+	std::vector<std::pair<size_t, size_t>> productions;
+	capture_spans captures;
+
+	for (size_t first = 0; 0 != tokens[first].id; ) {
+		const size_t last = match_at(psm, tokens, first, stack, scratch);
+
+		if (last == first) {
+			first++;
+		} else {
+			capture(psm, tokens, first, last, stack, productions, captures);
+			if (!fn(captures)) {
+				break;
+			}
+			first = last;
+		}
+		tokens.release(first);
+	}
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+#ifndef PARLE_PARSER_VALIDATE_HPP
+#define PARLE_PARSER_VALIDATE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "include/parsertl/match_results.hpp"
+#include "parle/lexer/keywords.hpp"
+#include "parle/lexer/tokenize.hpp"
+
+#undef lookup
+
+namespace parle
+{
+namespace parser
+{
+struct no_snapshot
+{
+	template<typename stack_type>
+	void operator ()(const stack_type &) const
+	{
+	}
+};
+
+// Line and column the way the lexer iterator counts them before every
+// lookup, by the tokens returned only. Skipped input isn't seen.
+struct position
+{
+	size_t line = SIZE_MAX;
+	size_t column = SIZE_MAX;
+
+	template<typename results>
+	void next(const results &res)
+	{
+		if (res.bol) {
+			line++;
+			column = 0;
+		} else {
+			column += res.second - res.first;
+		}
+	}
+};
+
+// Stand-in for stats::counter when nothing is counted.
+struct no_counter
+{
+	void token(std::size_t, std::size_t) const
+	{
+	}
+
+	void shift(std::size_t) const
+	{
+	}
+
+	void reduce(std::size_t) const
+	{
+	}
+
+	void go_to(std::size_t) const
+	{
+	}
+};
+
+// Lex and parse [begin, end) in one loop, without a token iterator and
+// without tracking productions. The same steps as parsertl::parse() over
+// a lexer iterator, so callouts aren't supported. On return pres holds the
+// parser state as parse() leaves it and at the lexer state the lookup of
+// the last token started with, the one of the offending or the EOI token.
+// where gets the line and column the iterator has on that token. The
+// snapshot is passed the parser stack before every token lookup, the
+// counter is told about every token and parser step.
+template<typename results, typename lex_sm_type, typename table_type, typename par_sm_type, typename iter, typename snapshot_type = no_snapshot,
+	typename counter_type = no_counter>
+bool validate(const lex_sm_type &lsm, const table_type &keywords, const par_sm_type &psm, const iter &begin, const iter &end,
+	parsertl::basic_match_results<par_sm_type> &pres, lexer::token_entry<typename results::id_type> &at, position &where, snapshot_type snapshot = snapshot_type(),
+	counter_type counter = counter_type())
+{
+	using id_type = typename par_sm_type::id_type;
+	using entry_type = typename par_sm_type::entry;
+	results res(begin, end);
+	auto &stack = pres.stack;
+	entry_type entry;
+	bool ret = false;
+
+	/* Kept in locals through the loop, pres is only written at the end. */
+	auto next = [&]() {
+		snapshot(stack);
+		at = lexer::entry_of(res, begin);
+		where.next(res);
+		lexer::lookup(lsm, res, keywords);
+		counter.token(res.id, res.second - res.first);
+		if (res.id == results::npos()) {
+			entry.action = parsertl::action::error;
+			entry.param = static_cast<id_type>(parsertl::error_type::unknown_token);
+			return false;
+		}
+		return true;
+	};
+
+	where = position();
+	stack.clear();
+	stack.push_back(0);
+	if (next()) {
+		entry = psm.at(0, res.id);
+	}
+
+	for (bool done = false; !done; ) {
+		switch (entry.action) {
+		case parsertl::action::shift:
+			stack.push_back(entry.param);
+			counter.shift(stack.size());
+			if (0 != res.id && !next()) {
+				done = true;
+				break;
+			}
+			entry = psm.at(entry.param, res.id);
+			break;
+		case parsertl::action::reduce:
+		{
+			const auto &rule = psm._rules[entry.param];
+
+			counter.reduce(entry.param);
+			stack.resize(stack.size() - rule.second.size());
+			entry = psm.at(stack.back(), rule.first);
+			if (parsertl::action::go_to == entry.action) {
+				/* A goto always follows, take it right away. */
+				stack.push_back(entry.param);
+				counter.go_to(stack.size());
+				entry = psm.at(entry.param, res.id);
+			}
+			break;
+		}
+		case parsertl::action::go_to:
+			stack.push_back(entry.param);
+			counter.go_to(stack.size());
+			entry = psm.at(entry.param, res.id);
+			break;
+		case parsertl::action::accept:
+			stack.resize(stack.size() - psm._rules[entry.param].second.size());
+			ret = true;
+			done = true;
+			break;
+		default:
+			done = true;
+			break;
+		}
+	}
+
+	pres.token_id = res.id;
+	pres.entry = entry;
+
+	return ret;
+}
+
+// Whether the parser can go on with the terminal from the stack, that is
+// shift or accept it after the reductions it causes. The stack is worked
+// on in place, pass a copy.
+template<typename par_sm_type, typename stack_type>
+bool accepts(const par_sm_type &psm, stack_type &stack, const std::size_t terminal)
+{
+	auto entry = psm.at(stack.back(), terminal);
+
+	while (true) {
+		switch (entry.action) {
+		case parsertl::action::shift:
+		case parsertl::action::accept:
+			return true;
+		case parsertl::action::reduce:
+		{
+			const auto &rule = psm._rules[entry.param];
+
+			stack.resize(stack.size() - rule.second.size());
+			entry = psm.at(stack.back(), rule.first);
+			break;
+		}
+		case parsertl::action::go_to:
+			stack.push_back(entry.param);
+			entry = psm.at(stack.back(), terminal);
+			break;
+		default:
+			return false;
+		}
+	}
+}
+
+// The terminals the parse of [begin, end) could have continued with where
+// it failed. The input is parsed again to get the stack from before the
+// reductions the offending token caused. Every terminal is tried on it, so
+// unlike the row of the error state this stays exact with default
+// reductions and LALR lookaheads.
+template<typename results, typename lex_sm_type, typename table_type, typename par_sm_type, typename iter>
+std::vector<std::size_t> expected(const lex_sm_type &lsm, const table_type &keywords, const par_sm_type &psm, const iter &begin, const iter &end,
+	const std::size_t terminals)
+{
+	parsertl::basic_match_results<par_sm_type> pres;
+	lexer::token_entry<typename results::id_type> at;
+	position where;
+	std::vector<typename par_sm_type::id_type> saved;
+	std::vector<std::size_t> ret;
+
+	if (validate<results>(lsm, keywords, psm, begin, end, pres, at, where, [&saved](const decltype(saved) &stack) { saved = stack; })) {
+		return ret;
+	}
+
+	for (std::size_t terminal = 0; terminal < terminals; terminal++) {
+		auto stack = saved;
+
+		if (accepts(psm, stack, terminal)) {
+			ret.push_back(terminal);
+		}
+	}
+
+	return ret;
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
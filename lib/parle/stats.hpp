@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2022 Anatol Belski
+ * All rights reserved.
+ *
+ * Author: Anatol Belski <ab@php.net>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *	notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *	notice, this list of conditions and the following disclaimer in the
+ *	documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/* $Id$ */
+
+#ifndef PARLE_STATS_HPP
+#define PARLE_STATS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "include/parsertl/enums.hpp"
+#include "include/parsertl/lookup.hpp"
+#include "include/parsertl/parse.hpp"
+#include "parle/parser/validate.hpp"
+
+// Counting code is only compiled with --enable-parle-stats, otherwise the
+// statement passed vanishes. The counters themselves always exist.
+#ifdef HAVE_PARLE_STATS
+#define PARLE_STATS(...) __VA_ARGS__
+#else
+#define PARLE_STATS(...)
+#endif
+
+namespace parle
+{
+namespace stats
+{
+using clock = std::chrono::steady_clock;
+
+// Build phases in the order they ran, with their time in seconds.
+using phases = std::vector<std::pair<std::string, double>>;
+
+struct lexer_stats
+{
+	std::map<std::size_t, uint64_t> tokens;
+	uint64_t bytes = 0;
+	uint64_t callouts = 0;
+	double callout_time = 0;
+	// Of the last build, not touched by reset().
+	phases build;
+
+	void token(const std::size_t id, const std::size_t len)
+	{
+		tokens[id]++;
+		bytes += len;
+	}
+
+	// Take back a token that was counted twice.
+	void untoken(const std::size_t id, const std::size_t len)
+	{
+		auto it = tokens.find(id);
+
+		if (tokens.end() != it && 0 == --it->second) {
+			tokens.erase(it);
+		}
+		bytes -= len;
+	}
+
+	// Add the counts of rhs, the build phases are left alone.
+	void add(const lexer_stats &rhs)
+	{
+		for (const auto &t : rhs.tokens) {
+			tokens[t.first] += t.second;
+		}
+		bytes += rhs.bytes;
+		callouts += rhs.callouts;
+		callout_time += rhs.callout_time;
+	}
+
+	void reset()
+	{
+		tokens.clear();
+		bytes = callouts = 0;
+		callout_time = 0;
+	}
+};
+
+struct parser_stats
+{
+	uint64_t shifts = 0;
+	uint64_t gotos = 0;
+	std::size_t max_depth = 0;
+	std::vector<uint64_t> reduces;
+	// Of the last build, not touched by reset().
+	phases build;
+
+	void shift(const std::size_t depth)
+	{
+		shifts++;
+		max_depth = std::max(max_depth, depth);
+	}
+
+	void reduce(const std::size_t rule)
+	{
+		if (rule >= reduces.size()) {
+			reduces.resize(rule + 1, 0);
+		}
+		reduces[rule]++;
+	}
+
+	void go_to(const std::size_t depth)
+	{
+		gotos++;
+		max_depth = std::max(max_depth, depth);
+	}
+
+	// Count the action parsertl::lookup() is about to take.
+	template<typename results_type>
+	void step(const results_type &results)
+	{
+		switch (results.entry.action) {
+		case parsertl::action::shift:
+			shift(results.stack.size() + 1);
+			break;
+		case parsertl::action::reduce:
+			reduce(results.entry.param);
+			break;
+		case parsertl::action::go_to:
+			go_to(results.stack.size() + 1);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void add(const parser_stats &rhs)
+	{
+		shifts += rhs.shifts;
+		gotos += rhs.gotos;
+		max_depth = std::max(max_depth, rhs.max_depth);
+		if (rhs.reduces.size() > reduces.size()) {
+			reduces.resize(rhs.reduces.size(), 0);
+		}
+		for (std::size_t i = 0; i < rhs.reduces.size(); i++) {
+			reduces[i] += rhs.reduces[i];
+		}
+	}
+
+	void reset()
+	{
+		shifts = gotos = 0;
+		max_depth = 0;
+		reduces.clear();
+	}
+};
+
+// Adds the time until it goes out of scope as a build phase.
+class timer
+{
+public:
+	timer(phases &out, const char *name) :
+		_out(out),
+		_name(name),
+		_start(clock::now())
+	{
+	}
+
+	~timer()
+	{
+		_out.emplace_back(_name, std::chrono::duration<double>(clock::now() - _start).count());
+	}
+
+private:
+	phases &_out;
+	const char *_name;
+	clock::time_point _start;
+};
+
+// Run fn as a build phase, timed when enabled. Returns what fn returns.
+template<typename fn_type>
+auto phase(phases &out, const char *name, fn_type fn) -> decltype(fn())
+{
+#ifdef HAVE_PARLE_STATS
+	timer t(out, name);
+#else
+	(void)out;
+	(void)name;
+#endif
+	return fn();
+}
+
+// Counts a callout and its time until it goes out of scope.
+class callout_timer
+{
+public:
+	explicit callout_timer(lexer_stats &stats) :
+		_stats(stats),
+		_start(clock::now())
+	{
+	}
+
+	~callout_timer()
+	{
+		_stats.callouts++;
+		_stats.callout_time += std::chrono::duration<double>(clock::now() - _start).count();
+	}
+
+private:
+	lexer_stats &_stats;
+	clock::time_point _start;
+};
+
+// The counter parle::parser::validate() reports to.
+struct counter
+{
+	lexer_stats *lex;
+	parser_stats *par;
+
+	void token(const std::size_t id, const std::size_t len)
+	{
+		lex->token(id, len);
+	}
+
+	void shift(const std::size_t depth)
+	{
+		par->shift(depth);
+	}
+
+	void reduce(const std::size_t rule)
+	{
+		par->reduce(rule);
+	}
+
+	void go_to(const std::size_t depth)
+	{
+		par->go_to(depth);
+	}
+};
+
+// Counts of a run that may yet be thrown away, kept aside until commit()
+// adds them to the stats of the lexer and the parser. Empty when disabled.
+#ifdef HAVE_PARLE_STATS
+struct pending
+{
+	lexer_stats lex;
+	parser_stats par;
+
+	template<typename lexer_type, typename parser_type>
+	void commit(lexer_type &lex_, parser_type &par_) const
+	{
+		lex_.stats.add(lex);
+		par_.stats.add(par);
+	}
+};
+
+inline counter counter_for(pending &p)
+{
+	return {&p.lex, &p.par};
+}
+#else
+struct pending
+{
+	template<typename lexer_type, typename parser_type>
+	void commit(lexer_type &, parser_type &) const
+	{
+	}
+};
+
+inline parser::no_counter counter_for(pending &)
+{
+	return {};
+}
+#endif
+
+// parsertl::parse(), but with every step counted when enabled.
+template<typename lexer_iterator, typename sm_type, typename results_type>
+bool parse(lexer_iterator &iter, const sm_type &sm, results_type &results, parser_stats &stats)
+{
+#ifdef HAVE_PARLE_STATS
+	while (parsertl::action::error != results.entry.action && parsertl::action::accept != results.entry.action) {
+		stats.step(results);
+		parsertl::lookup(iter, sm, results);
+	}
+	if (parsertl::action::accept == results.entry.action) {
+		/* Pops the start rule, as parse() does. */
+		parsertl::lookup(iter, sm, results);
+		return true;
+	}
+	return false;
+#else
+	(void)stats;
+	return parsertl::parse(iter, sm, results);
+#endif
+}
+}
+}
+
+#endif
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * c-basic-offset: 4
+ * End:
+ * vim600: noet sw=4 ts=4 fdm=marker
+ * vim<600: noet sw=4 ts=4
+ */
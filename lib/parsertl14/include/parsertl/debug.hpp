@@ -12,11 +12,11 @@
 
 namespace parsertl
 {
-    template<typename char_type>
+    template<typename char_type, typename id_type = uint16_t>
     class basic_debug
     {
     public:
-        using rules = basic_rules<char_type>;
+        using rules = basic_rules<char_type, id_type>;
         using ostream = std::basic_ostream<char_type>;
 
         static void dump(const rules& rules_, ostream& stream_)
@@ -11,6 +11,7 @@
 #include "nt_info.hpp"
 #include "rules.hpp"
 #include "state_machine.hpp"
+#include <unordered_map>
 
 namespace parsertl
 {
@@ -88,6 +89,15 @@ namespace parsertl
             const std::size_t terminals_ = rules_.tokens_info().size();
             const std::size_t start_ = rules_.start();
             hash_map hash_map_;
+            // Per state scratch space, reset after each use.
+            char_vector in_closure_(grammar_.size(), 0);
+            size_t_vector symbol_index_(terminals_ +
+                rules_.nt_locations().size(), npos());
+            size_t_vector symbols_;
+            // Successor item sets, kept across states so that the vectors
+            // not handed over to a new state are reused along with their
+            // capacity.
+            std::vector<size_t_pair_vector> item_sets_;
 
             dfa_.emplace_back();
 
@@ -111,17 +121,15 @@ namespace parsertl
             for (std::size_t s_ = 0; s_ < dfa_.size(); ++s_)
             {
                 dfa_state& state_ = dfa_[s_];
-                size_t_vector symbols_;
-                using item_sets = std::vector<size_t_pair_vector>;
-                item_sets item_sets_;
 
+                symbols_.clear();
                 state_._closure.assign(state_._basis.begin(),
                     state_._basis.end());
-                closure(rules_, state_);
+                closure(rules_, state_, in_closure_);
 
                 for (const auto& pair_ : state_._closure)
                 {
-                    const production p_ = grammar_[pair_.first];
+                    const production& p_ = grammar_[pair_.first];
 
                     if (pair_.second < p_._rhs.first.size())
                     {
@@ -129,38 +137,38 @@ namespace parsertl
                         const std::size_t id_ =
                             symbol_._type == symbol::type::TERMINAL ?
                             symbol_._id : terminals_ + symbol_._id;
-                        auto sym_iter_ = std::find(symbols_.begin(),
-                            symbols_.end(), id_);
-                        size_t_pair new_pair_(pair_.first, pair_.second + 1);
+                        std::size_t& index_ = symbol_index_[id_];
 
-                        if (sym_iter_ == symbols_.end())
+                        if (index_ == npos())
                         {
+                            index_ = symbols_.size();
                             symbols_.push_back(id_);
-                            item_sets_.emplace_back();
-                            item_sets_.back().push_back(new_pair_);
-                        }
-                        else
-                        {
-                            const std::size_t index_ =
-                                sym_iter_ - symbols_.begin();
-                            size_t_pair_vector& vec_ = item_sets_[index_];
-                            auto i_ = std::find(vec_.begin(), vec_.end(),
-                                new_pair_);
 
-                            if (i_ == vec_.end())
+                            if (item_sets_.size() < symbols_.size())
+                            {
+                                item_sets_.emplace_back();
+                            }
+                            else
                             {
-                                vec_.push_back(new_pair_);
+                                item_sets_[index_].clear();
                             }
                         }
+
+                        // Closure items are unique, so are their successors.
+                        item_sets_[index_].emplace_back(pair_.first,
+                            pair_.second + 1);
                     }
                 }
 
+                state_._transitions.reserve(symbols_.size());
+
                 for (auto iter_ = symbols_.cbegin(), end_ = symbols_.cend();
                     iter_ != end_; ++iter_)
                 {
                     std::size_t index_ = iter_ - symbols_.begin();
                     size_t_pair_vector& basis_ = item_sets_[index_];
 
+                    symbol_index_[*iter_] = npos();
                     std::sort(basis_.begin(), basis_.end());
                     index_ = add_dfa_state(dfa_, hash_map_, basis_);
                     state_._transitions.emplace_back(*iter_, index_);
@@ -199,6 +207,9 @@ namespace parsertl
                     prod prod_;
 
                     prod_._production = &production_;
+                    prod_._rhs.reserve(production_._rhs.first.size());
+                    prod_._rhs_indexes.reserve(std::max<std::size_t>
+                        (production_._rhs.first.size(), 1));
 
                     if (production_._lhs != start_)
                     {
@@ -380,109 +391,67 @@ namespace parsertl
             } while (progress_);
         }
 
+        // DeRemer & Pennello style propagation. FOLLOW(B) gets what can
+        // directly follow B and includes FOLLOW(A) for every A -> x B y
+        // with y nullable. Instead of iterating to a fixpoint, the includes
+        // relation is traversed once by digraph().
         static void build_follow_sets(const prod_vector& grammar_,
             nt_info_vector& nt_info_)
         {
-            for (;;)
+            std::vector<size_t_vector> includes_(nt_info_.size());
+
+            for (const auto& prod_ : grammar_)
             {
-                bool changes_ = false;
+                auto rhs_iter_ = prod_._rhs.cbegin();
+                auto rhs_end_ = prod_._rhs.cend();
 
-                for (const auto& prod_ : grammar_)
+                for (; rhs_iter_ != rhs_end_; ++rhs_iter_)
                 {
-                    auto rhs_iter_ = prod_._rhs.cbegin();
-                    auto rhs_end_ = prod_._rhs.cend();
+                    if (rhs_iter_->_type != symbol::type::NON_TERMINAL)
+                        continue;
+
+                    nt_info& lhs_info_ = nt_info_[rhs_iter_->_id];
+                    auto next_iter_ = rhs_iter_ + 1;
 
-                    for (; rhs_iter_ != rhs_end_; ++rhs_iter_)
+                    for (; next_iter_ != rhs_end_; ++next_iter_)
                     {
-                        if (rhs_iter_->_type == symbol::type::NON_TERMINAL)
+                        if (next_iter_->_type == symbol::type::TERMINAL)
                         {
-                            auto next_iter_ = rhs_iter_ + 1;
-                            nt_info& lhs_info_ = nt_info_[rhs_iter_->_id];
-                            bool nullable_ = next_iter_ == rhs_end_;
+                            // Just add terminal.
+                            set_add(lhs_info_._follow_set, next_iter_->_id);
+                            break;
+                        }
 
-                            if (next_iter_ != rhs_end_)
-                            {
-                                if (next_iter_->_type == symbol::type::TERMINAL)
-                                {
-                                    const std::size_t id_ = next_iter_->_id;
-
-                                    // Just add terminal.
-                                    changes_ |= set_add
-                                    (lhs_info_._follow_set, id_);
-                                }
-                                else
-                                {
-                                    // If there is a production A -> aBb
-                                    // then everything in FIRST(b) is
-                                    // placed in FOLLOW(B).
-                                    const nt_info* rhs_info_ =
-                                        &nt_info_[next_iter_->_id];
-
-                                    changes_ |= set_union(lhs_info_._follow_set,
-                                        rhs_info_->_first_set);
-                                    ++next_iter_;
-
-                                    // If nullable, keep going
-                                    if (rhs_info_->_nullable)
-                                    {
-                                        for (; next_iter_ != rhs_end_;
-                                            ++next_iter_)
-                                        {
-                                            auto next_id_ =
-                                                static_cast<std::size_t>(~0);
-
-                                            if (next_iter_->_type ==
-                                                symbol::type::TERMINAL)
-                                            {
-                                                next_id_ = next_iter_->_id;
-                                                // Just add terminal.
-                                                changes_ |= set_add
-                                                (lhs_info_._follow_set,
-                                                    next_id_);
-                                                break;
-                                            }
-                                            else
-                                            {
-                                                next_id_ = next_iter_->_id;
-                                                rhs_info_ = &nt_info_[next_id_];
-                                                changes_ |= set_union
-                                                (lhs_info_._follow_set,
-                                                    rhs_info_->_first_set);
-
-                                                if (!rhs_info_->_nullable)
-                                                {
-                                                    break;
-                                                }
-                                            }
-                                        }
-
-                                        nullable_ = next_iter_ == rhs_end_;
-                                    }
-                                }
-                            }
+                        // If there is a production A -> aBb
+                        // then everything in FIRST(b) is
+                        // placed in FOLLOW(B).
+                        const nt_info& rhs_info_ = nt_info_[next_iter_->_id];
 
-                            if (nullable_)
-                            {
-                                // If there is a production A -> aB
-                                // then everything in FOLLOW(A) is in FOLLOW(B).
-                                const nt_info& rhs_info_ = nt_info_[prod_._lhs];
+                        set_union(lhs_info_._follow_set,
+                            rhs_info_._first_set);
 
-                                changes_ |= set_union(lhs_info_._follow_set,
-                                    rhs_info_._follow_set);
-                            }
-                        }
+                        // If nullable, keep going
+                        if (!rhs_info_._nullable) break;
                     }
-                }
 
-                if (!changes_) break;
+                    // If there is a production A -> aB
+                    // then everything in FOLLOW(A) is in FOLLOW(B).
+                    if (next_iter_ == rhs_end_ &&
+                        rhs_iter_->_id != prod_._lhs)
+                    {
+                        includes_[rhs_iter_->_id].push_back(prod_._lhs);
+                    }
+                }
             }
+
+            digraph(includes_, nt_info_);
         }
 
     private:
         using entry = typename sm::entry;
         using grammar = typename rules::production_vector;
         using size_t_vector = std::vector<std::size_t>;
-        using hash_map = std::map<std::size_t, size_t_vector>;
+        using hash_map = std::unordered_map<std::size_t, size_t_vector>;
         using string_vector = typename rules::string_vector;
         using symbol = typename rules::symbol;
         using token_info = typename rules::token_info;
@@ -499,7 +468,10 @@ namespace parsertl
             string_vector symbols_;
             const std::size_t columns_ = terminals_ + non_terminals_;
             std::size_t index_ = 0;
+            size_t_vector same_;
+            std::vector<size_t_pair_vector> reductions_;
 
+            reduction_index(grammar_, dfa_, new_grammar_, same_, reductions_);
             rules_.symbols(symbols_);
             sm_._columns = columns_;
             sm_._rows = dfa_.size();
@@ -534,16 +506,12 @@ namespace parsertl
                         char_vector follow_set_(terminals_, 0);
 
                         // config is reduction
-                        for (const auto& p_ : new_grammar_)
+                        for (const auto& r_ : reductions_[index_])
                         {
-                            if (production_._lhs == p_._production->_lhs &&
-                                production_._rhs == p_._production->_rhs &&
-                                index_ == p_._rhs_indexes.back().second)
+                            if (r_.first == same_[c_.first])
                             {
-                                const std::size_t lhs_id_ = p_._lhs;
-
                                 set_union(follow_set_,
-                                    new_nt_info_[lhs_id_]._follow_set);
+                                    new_nt_info_[r_.second]._follow_set);
                             }
                         }
 
@@ -569,6 +537,38 @@ namespace parsertl
             }
         }
 
+        // The lookahead of a reduction in a state is the union of the follow
+        // sets of the rewritten productions ending in that state. Index them
+        // by final state as (production, new lhs) pairs. Identical
+        // productions are mapped to the first of them in same_.
+        static void reduction_index(const grammar& grammar_, const dfa& dfa_,
+            const prod_vector& new_grammar_, size_t_vector& same_,
+            std::vector<size_t_pair_vector>& reductions_)
+        {
+            std::map<std::pair<std::size_t, std::pair<symbol_vector, string>>,
+                std::size_t> map_;
+
+            same_.resize(grammar_.size());
+
+            for (std::size_t i_ = 0, size_ = grammar_.size(); i_ < size_; ++i_)
+            {
+                const production& production_ = grammar_[i_];
+
+                same_[i_] = map_.emplace(std::make_pair(production_._lhs,
+                    production_._rhs), i_).first->second;
+            }
+
+            reductions_.resize(dfa_.size());
+
+            for (const auto& p_ : new_grammar_)
+            {
+                const std::size_t index_ = p_._production - &grammar_.front();
+
+                reductions_[p_._rhs_indexes.back().second].
+                    emplace_back(same_[index_], p_._lhs);
+            }
+        }
+
         static void copy_rules(const rules& rules_, sm& sm_)
         {
             const grammar& grammar_ = rules_.grammar();
@@ -634,11 +634,22 @@ namespace parsertl
             return progress_;
         }
 
-        static void closure(const rules& rules_, dfa_state& state_)
+        // in_closure_ flags the productions already added with the dot at
+        // the start, it is cleared again before returning.
+        static void closure(const rules& rules_, dfa_state& state_,
+            char_vector& in_closure_)
         {
             const auto& nt_locations_ = rules_.nt_locations();
             const grammar& grammar_ = rules_.grammar();
 
+            for (const auto& pair_ : state_._closure)
+            {
+                if (pair_.second == 0)
+                {
+                    in_closure_[pair_.first] = 1;
+                }
+            }
+
             for (std::size_t c_ = 0; c_ < state_._closure.size(); ++c_)
             {
                 const size_t_pair pair_ = state_._closure[c_];
@@ -656,18 +667,104 @@ namespace parsertl
                             nt_locations_[symbol_._id]._first_production;
                             rule_ != npos(); rule_ = grammar_[rule_]._next_lhs)
                         {
-                            const size_t_pair new_pair_(rule_, 0);
-                            auto i_ = std::find(state_._closure.begin(),
-                                state_._closure.end(), new_pair_);
-
-                            if (i_ == state_._closure.end())
+                            if (!in_closure_[rule_])
                             {
-                                state_._closure.push_back(new_pair_);
+                                in_closure_[rule_] = 1;
+                                state_._closure.emplace_back(rule_, 0);
                             }
                         }
                     }
                 }
             }
+
+            for (const auto& pair_ : state_._closure)
+            {
+                if (pair_.second == 0)
+                {
+                    in_closure_[pair_.first] = 0;
+                }
+            }
+        }
+
+        // DeRemer & Pennello digraph(): F(x) = F'(x) U { F(y) | x R y }.
+        // Iterative Tarjan traversal, members of a strongly connected
+        // component end up with the same follow set.
+        static void digraph(const std::vector<size_t_vector>& relation_,
+            nt_info_vector& nt_info_)
+        {
+            struct call
+            {
+                std::size_t _x;
+                std::size_t _edge;
+                std::size_t _depth;
+            };
+
+            const std::size_t size_ = relation_.size();
+            size_t_vector depth_(size_, 0);
+            size_t_vector stack_;
+            std::vector<call> calls_;
+
+            for (std::size_t root_ = 0; root_ < size_; ++root_)
+            {
+                if (depth_[root_] != 0) continue;
+
+                stack_.push_back(root_);
+                depth_[root_] = stack_.size();
+                calls_.push_back({ root_, 0, stack_.size() });
+
+                while (!calls_.empty())
+                {
+                    call& call_ = calls_.back();
+                    const std::size_t x_ = call_._x;
+
+                    if (call_._edge < relation_[x_].size())
+                    {
+                        const std::size_t y_ = relation_[x_][call_._edge++];
+
+                        if (depth_[y_] == 0)
+                        {
+                            stack_.push_back(y_);
+                            depth_[y_] = stack_.size();
+                            calls_.push_back({ y_, 0, stack_.size() });
+                        }
+                        else
+                        {
+                            depth_[x_] = std::min(depth_[x_], depth_[y_]);
+                            set_union(nt_info_[x_]._follow_set,
+                                nt_info_[y_]._follow_set);
+                        }
+
+                        continue;
+                    }
+
+                    if (depth_[x_] == call_._depth)
+                    {
+                        for (;;)
+                        {
+                            const std::size_t t_ = stack_.back();
+
+                            stack_.pop_back();
+                            depth_[t_] = npos();
+
+                            if (t_ == x_) break;
+
+                            nt_info_[t_]._follow_set =
+                                nt_info_[x_]._follow_set;
+                        }
+                    }
+
+                    calls_.pop_back();
+
+                    if (!calls_.empty())
+                    {
+                        const std::size_t p_ = calls_.back()._x;
+
+                        depth_[p_] = std::min(depth_[p_], depth_[x_]);
+                        set_union(nt_info_[p_]._follow_set,
+                            nt_info_[x_]._follow_set);
+                    }
+                }
+            }
         }
 
         static std::size_t add_dfa_state(dfa& dfa_, hash_map& hash_map_,
@@ -703,17 +800,23 @@ namespace parsertl
 
         static std::size_t hash_set(const size_t_pair_vector& vec_)
         {
-            std::size_t hash_ = 0;
+            std::size_t hash_ = vec_.size();
 
             for (const auto& pair_ : vec_)
             {
-                hash_ *= 571;
-                hash_ += pair_.first * 37 + pair_.second;
+                hash_combine(hash_, pair_.first);
+                hash_combine(hash_, pair_.second);
             }
 
             return hash_;
         }
 
+        static void hash_combine(std::size_t& hash_, const std::size_t value_)
+        {
+            hash_ ^= std::hash<std::size_t>()(value_) + 0x9e3779b9 +
+                (hash_ << 6) + (hash_ >> 2);
+        }
+
         static bool fill_entry(const rules& rules_,
             const size_t_pair_vector& config_, const string_vector& symbols_,
             entry& lhs_, const std::size_t id_, const entry& rhs_,
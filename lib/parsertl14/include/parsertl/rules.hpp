@@ -126,37 +126,6 @@ namespace parsertl
         explicit basic_rules(const std::size_t flags_ = 0) :
             _flags(flags_)
         {
-            lexer_rules rules_;
-
-            rules_.insert_macro("TERMINAL",
-                R"('(\\([^0-9cx]|[0-9]{1,3}|c[@a-zA-Z]|x\d+)|[^'])+'|)"
-                R"(["](\\([^0-9cx]|[0-9]{1,3}|c[@a-zA-Z]|x\d+)|[^"])+["])");
-            rules_.insert_macro("IDENTIFIER", "[A-Za-z_.][-A-Za-z_.0-9]*");
-            rules_.push("{TERMINAL}",
-                static_cast<uint16_t>(ebnf_tables::yytokentype::TERMINAL));
-            rules_.push("{IDENTIFIER}",
-                static_cast<uint16_t>(ebnf_tables::yytokentype::IDENTIFIER));
-            rules_.push("\\s+", rules_.skip());
-            lexer_generator::build(rules_, _token_lexer);
-
-            rules_.push("[|]", '|');
-            rules_.push("\\[", '[');
-            rules_.push("\\]", ']');
-            rules_.push("[?]", '?');
-            rules_.push("[{]", '{');
-            rules_.push("[}]", '}');
-            rules_.push("[*]", '*');
-            rules_.push("-", '-');
-            rules_.push("[+]", '+');
-            rules_.push("[(]", '(');
-            rules_.push("[)]", ')');
-            rules_.push("%empty",
-                static_cast<uint16_t>(ebnf_tables::yytokentype::EMPTY));
-            rules_.push("%prec",
-                static_cast<uint16_t>(ebnf_tables::yytokentype::PREC));
-            rules_.push("[/][*].{+}[\r\n]*?[*][/]|[/][/].*", rules_.skip());
-            lexer_generator::build(rules_, _rule_lexer);
-
             const std::size_t id_ = insert_terminal(string(1, '$'));
 
             info(id_);
@@ -190,7 +159,8 @@ namespace parsertl
 
         void token(const char_type* names_)
         {
-            lexer_iterator iter_(names_, str_end(names_), _token_lexer);
+            lexer_iterator iter_(names_, str_end(names_),
+                meta()._token_lexer);
 
             token(iter_, 0, associativity::token_assoc, "token");
         }
@@ -198,14 +168,15 @@ namespace parsertl
         void token(const string& names_)
         {
             lexer_iterator iter_(names_.c_str(), names_.c_str() + names_.size(),
-                _token_lexer);
+                meta()._token_lexer);
 
             token(iter_, 0, associativity::token_assoc, "token");
         }
 
         void left(const char_type* names_)
         {
-            lexer_iterator iter_(names_, str_end(names_), _token_lexer);
+            lexer_iterator iter_(names_, str_end(names_),
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::left_assoc, "left");
             ++_next_precedence;
@@ -214,7 +185,7 @@ namespace parsertl
         void left(const string& names_)
         {
             lexer_iterator iter_(names_.c_str(), names_.c_str() + names_.size(),
-                _token_lexer);
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::left_assoc, "left");
             ++_next_precedence;
@@ -222,7 +193,8 @@ namespace parsertl
 
         void right(const char_type* names_)
         {
-            lexer_iterator iter_(names_, str_end(names_), _token_lexer);
+            lexer_iterator iter_(names_, str_end(names_),
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::right_assoc, "right");
             ++_next_precedence;
@@ -231,7 +203,7 @@ namespace parsertl
         void right(const string& names_)
         {
             lexer_iterator iter_(names_.c_str(), names_.c_str() + names_.size(),
-                _token_lexer);
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::right_assoc, "right");
             ++_next_precedence;
@@ -239,7 +211,8 @@ namespace parsertl
 
         void nonassoc(const char_type* names_)
         {
-            lexer_iterator iter_(names_, str_end(names_), _token_lexer);
+            lexer_iterator iter_(names_, str_end(names_),
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::non_assoc,
                 "nonassoc");
@@ -249,7 +222,7 @@ namespace parsertl
         void nonassoc(const string& names_)
         {
             lexer_iterator iter_(names_.c_str(), names_.c_str() + names_.size(),
-                _token_lexer);
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::non_assoc,
                 "nonassoc");
@@ -258,7 +231,8 @@ namespace parsertl
 
         void precedence(const char_type* names_)
         {
-            lexer_iterator iter_(names_, str_end(names_), _token_lexer);
+            lexer_iterator iter_(names_, str_end(names_),
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::precedence_assoc,
                 "precedence");
@@ -268,7 +242,7 @@ namespace parsertl
         void precedence(const string& names_)
         {
             lexer_iterator iter_(names_.c_str(), names_.c_str() + names_.size(),
-                _token_lexer);
+                meta()._token_lexer);
 
             token(iter_, _next_precedence, associativity::precedence_assoc,
                 "precedence");
@@ -304,7 +278,7 @@ namespace parsertl
             }
 
             lexer_iterator iter_(rhs_.c_str(), rhs_.c_str() + rhs_.size(),
-                _rule_lexer);
+                meta()._rule_lexer);
             basic_match_results<basic_state_machine<id_type>> results_;
             // Qualify token to prevent arg dependant lookup
             using token_t = parsertl::token<lexer_iterator>;
@@ -798,11 +772,58 @@ namespace parsertl
             typename lexertl::iterator<const char_type*, lexer_state_machine,
             typename lexertl::match_results<const char_type*>>;
 
+        // The lexers for the grammar notation are the same for every rule
+        // set. Build them once on first use and share them read-only.
+        struct meta_lexers
+        {
+            lexer_state_machine _token_lexer;
+            lexer_state_machine _rule_lexer;
+
+            meta_lexers()
+            {
+                lexer_rules rules_;
+
+                rules_.insert_macro("TERMINAL",
+                    R"('(\\([^0-9cx]|[0-9]{1,3}|c[@a-zA-Z]|x\d+)|[^'])+'|)"
+                    R"(["](\\([^0-9cx]|[0-9]{1,3}|c[@a-zA-Z]|x\d+)|[^"])+["])");
+                rules_.insert_macro("IDENTIFIER", "[A-Za-z_.][-A-Za-z_.0-9]*");
+                rules_.push("{TERMINAL}",
+                    static_cast<uint16_t>(ebnf_tables::yytokentype::TERMINAL));
+                rules_.push("{IDENTIFIER}",
+                    static_cast<uint16_t>(ebnf_tables::yytokentype::IDENTIFIER));
+                rules_.push("\\s+", rules_.skip());
+                lexer_generator::build(rules_, _token_lexer);
+
+                rules_.push("[|]", '|');
+                rules_.push("\\[", '[');
+                rules_.push("\\]", ']');
+                rules_.push("[?]", '?');
+                rules_.push("[{]", '{');
+                rules_.push("[}]", '}');
+                rules_.push("[*]", '*');
+                rules_.push("-", '-');
+                rules_.push("[+]", '+');
+                rules_.push("[(]", '(');
+                rules_.push("[)]", ')');
+                rules_.push("%empty",
+                    static_cast<uint16_t>(ebnf_tables::yytokentype::EMPTY));
+                rules_.push("%prec",
+                    static_cast<uint16_t>(ebnf_tables::yytokentype::PREC));
+                rules_.push("[/][*].{+}[\r\n]*?[*][/]|[/][/].*", rules_.skip());
+                lexer_generator::build(rules_, _rule_lexer);
+            }
+        };
+
+        static const meta_lexers& meta()
+        {
+            static const meta_lexers lexers_;
+
+            return lexers_;
+        }
+
         std::size_t _flags;
         ebnf_tables _ebnf_tables;
         std::size_t _next_precedence = 1;
-        lexer_state_machine _rule_lexer;
-        lexer_state_machine _token_lexer;
         string_id_type_map _terminals;
         token_info_vector _tokens_info;
         string_id_type_map _non_terminals;
@@ -832,7 +853,7 @@ namespace parsertl
 
             for (; iter_ != end_; ++iter_)
             {
-                if (iter_->id == _token_lexer.npos())
+                if (iter_->id == meta()._token_lexer.npos())
                 {
                     std::ostringstream ss_;
 
@@ -901,7 +922,7 @@ namespace parsertl
             const id_type lhs_id_ = insert_non_terminal(lhs_);
             nt_location& location_ = location(lhs_id_);
             lexer_iterator iter_(rhs_.c_str(), rhs_.c_str() +
-                rhs_.size(), _rule_lexer);
+                rhs_.size(), meta()._rule_lexer);
             basic_match_results<basic_state_machine<id_type>> results_;
             // Qualify token to prevent arg dependant lookup
             using token_t = parsertl::token<lexer_iterator>;
@@ -92,6 +92,15 @@ namespace parsertl
         using table = std::vector<id_type_entry_pair_vec>;
 
         table _table;
+        // Per state entry for tokens missing from the row,
+        // empty unless default_reductions() was called.
+        std::vector<entry> _defaults;
+        // Comb vector form of _table after compress(), as bison's
+        // yytable/yycheck. The row of a state starts at its _base in
+        // _next and owns the slots where _check holds the state.
+        std::vector<std::uint32_t> _base;
+        std::vector<entry> _next;
+        std::vector<id_type> _check;
 
         // No need to specify constructor.
         ~basic_state_machine() override = default;
@@ -100,15 +109,22 @@ namespace parsertl
         {
             base_sm::clear();
             _table.clear();
+            _defaults.clear();
+            _base.clear();
+            _next.clear();
+            _check.clear();
         }
 
         bool empty() const
         {
-            return _table.empty();
+            return _table.empty() && _check.empty();
         }
 
         entry at(const std::size_t state_) const
         {
+            if (!_check.empty())
+                return at(state_, 0);
+
             const auto& s_ = _table[state_];
             auto iter_ = std::find_if(s_.begin(), s_.end(),
                 [](const auto& pair)
@@ -117,13 +133,23 @@ namespace parsertl
                 });
 
             if (iter_ == s_.end())
-                return entry();
+                return _defaults.empty() ? entry() : _defaults[state_];
             else
                 return iter_->second;
         }
 
         entry at(const std::size_t state_, const std::size_t token_id_) const
         {
+            if (!_check.empty())
+            {
+                const std::size_t index_ = _base[state_] + token_id_;
+
+                if (index_ < _check.size() && _check[index_] == state_)
+                    return _next[index_];
+                else
+                    return _defaults.empty() ? entry() : _defaults[state_];
+            }
+
             const auto& s_ = _table[state_];
             auto iter_ = std::find_if(s_.begin(), s_.end(),
                 [token_id_](const auto& pair)
@@ -132,7 +158,7 @@ namespace parsertl
                 });
 
             if (iter_ == s_.end())
-                return entry();
+                return _defaults.empty() ? entry() : _defaults[state_];
             else
                 return iter_->second;
         }
@@ -157,6 +183,244 @@ namespace parsertl
         {
             _table.resize(base_sm::_rows);
         }
+
+        // Move the most frequent reduction of every state out of its row,
+        // at() returns it for any token the row doesn't list. A syntax
+        // error is then only detected once the reductions reach a state
+        // without a default, before the offending token is shifted.
+        void default_reductions()
+        {
+            _defaults.resize(_table.size());
+
+            for (std::size_t state_ = 0, size_ = _table.size();
+                state_ < size_; ++state_)
+            {
+                auto& s_ = _table[state_];
+                std::vector<std::pair<id_type, std::size_t>> counts_;
+
+                if (_defaults[state_].action != action::error)
+                    continue;
+
+                for (const auto& pair_ : s_)
+                {
+                    if (pair_.second.action != action::reduce)
+                        continue;
+
+                    auto iter_ = std::find_if(counts_.begin(), counts_.end(),
+                        [&pair_](const auto& count_)
+                        {
+                            return count_.first == pair_.second.param;
+                        });
+
+                    if (iter_ == counts_.end())
+                        counts_.emplace_back(pair_.second.param, 1);
+                    else
+                        ++iter_->second;
+                }
+
+                if (counts_.empty())
+                    continue;
+
+                // Ties go to the lowest rule, so the result is stable.
+                auto max_ = std::max_element(counts_.begin(), counts_.end(),
+                    [](const auto& lhs_, const auto& rhs_)
+                    {
+                        return lhs_.second < rhs_.second ||
+                            (lhs_.second == rhs_.second &&
+                                lhs_.first > rhs_.first);
+                    });
+                const entry default_(action::reduce, max_->first);
+
+                s_.erase(std::remove_if(s_.begin(), s_.end(),
+                    [&default_](const auto& pair_)
+                    {
+                        return pair_.second == default_;
+                    }), s_.end());
+                _defaults[state_] = default_;
+            }
+        }
+
+        // Let gotos skip states whose only action is the default reduction
+        // of a unit rule (A: B). Such a state is popped again right away,
+        // going straight to the goto on A gives the same parse minus that
+        // reduction. Call after default_reductions().
+        void eliminate_unit_rules()
+        {
+            if (_defaults.empty())
+                return;
+
+            for (std::size_t state_ = 0, size_ = _table.size();
+                state_ < size_; ++state_)
+            {
+                for (auto& pair_ : _table[state_])
+                {
+                    if (pair_.second.action != action::go_to)
+                        continue;
+
+                    // Bounded in case of cyclic unit rules.
+                    for (std::size_t i_ = 0; i_ < size_; ++i_)
+                    {
+                        const std::size_t rule_ =
+                            unit_rule(pair_.second.param);
+
+                        if (rule_ == npos())
+                            break;
+
+                        const entry next_ =
+                            at(state_, base_sm::_rules[rule_].first);
+
+                        if (next_.action != action::go_to)
+                            break;
+
+                        pair_.second.param = next_.param;
+                    }
+                }
+            }
+        }
+
+        // Pack the rows into one comb vector and drop _table. Every row
+        // is placed at the lowest offset where its entries only fall on
+        // free slots, longest rows first. at() then takes a single index
+        // and compare. Call last, the other passes work on _table.
+        void compress()
+        {
+            const id_type free_ = static_cast<id_type>(~0);
+
+            if (_table.empty() || base_sm::_rows >= free_)
+                return;
+
+            std::vector<std::size_t> order_(_table.size());
+            // One bit per taken slot.
+            std::vector<std::uint64_t> used_;
+            std::size_t first_free_ = 0;
+            // The 64 bits from slot bit_ on, slots past the end are free.
+            auto bits_ = [&used_](const std::size_t bit_)
+            {
+                const std::size_t word_ = bit_ / 64;
+                const std::size_t shift_ = bit_ % 64;
+                const std::uint64_t lo_ =
+                    word_ < used_.size() ? used_[word_] : 0;
+                const std::uint64_t hi_ =
+                    word_ + 1 < used_.size() ? used_[word_ + 1] : 0;
+
+                return shift_ ? (lo_ >> shift_) | (hi_ << (64 - shift_)) : lo_;
+            };
+
+            for (std::size_t i_ = 0; i_ < order_.size(); ++i_)
+            {
+                order_[i_] = i_;
+            }
+
+            std::stable_sort(order_.begin(), order_.end(),
+                [this](const std::size_t lhs_, const std::size_t rhs_)
+                {
+                    return _table[lhs_].size() > _table[rhs_].size();
+                });
+            _base.assign(_table.size(), 0);
+            _next.clear();
+            _check.clear();
+
+            for (const std::size_t state_ : order_)
+            {
+                const auto& s_ = _table[state_];
+
+                if (s_.empty())
+                    continue;
+
+                const std::size_t min_ = std::min_element(s_.begin(),
+                    s_.end(), [](const auto& lhs_, const auto& rhs_)
+                    {
+                        return lhs_.first < rhs_.first;
+                    })->first;
+                // Slots below first_free_ are taken, so is the lowest.
+                std::size_t base_ = first_free_ > min_ ?
+                    first_free_ - min_ : 0;
+
+                // Try 64 offsets at a time, a bit stays set for every
+                // offset all entries of the row fit at.
+                for (;; base_ += 64)
+                {
+                    std::uint64_t fits_ = ~static_cast<std::uint64_t>(0);
+
+                    for (const auto& pair_ : s_)
+                    {
+                        fits_ &= ~bits_(base_ + pair_.first);
+                    }
+
+                    if (fits_)
+                    {
+                        for (; !(fits_ & 1); fits_ >>= 1)
+                        {
+                            ++base_;
+                        }
+
+                        break;
+                    }
+                }
+
+                _base[state_] = static_cast<std::uint32_t>(base_);
+
+                for (const auto& pair_ : s_)
+                {
+                    const std::size_t index_ = base_ + pair_.first;
+
+                    if (index_ >= _check.size())
+                    {
+                        used_.resize(index_ / 64 + 1, 0);
+                        _next.resize(index_ + 1);
+                        _check.resize(index_ + 1, free_);
+                    }
+
+                    used_[index_ / 64] |= static_cast<std::uint64_t>(1) <<
+                        (index_ % 64);
+                    _next[index_] = pair_.second;
+                    _check[index_] = static_cast<id_type>(state_);
+                }
+
+                while (bits_(first_free_) & 1)
+                {
+                    ++first_free_;
+                }
+            }
+
+            if (_check.empty())
+                _check.push_back(free_);
+
+            table().swap(_table);
+        }
+
+    private:
+        static std::size_t npos()
+        {
+            return static_cast<std::size_t>(~0);
+        }
+
+        // The unit rule state_ always reduces by, npos() if it does
+        // anything else. Rules with captures are kept.
+        std::size_t unit_rule(const std::size_t state_) const
+        {
+            const entry& default_ = _defaults[state_];
+
+            if (default_.action != action::reduce ||
+                base_sm::_rules[default_.param].second.size() != 1)
+            {
+                return npos();
+            }
+
+            if (default_.param < base_sm::_captures.size() &&
+                !base_sm::_captures[default_.param].second.empty())
+            {
+                return npos();
+            }
+
+            for (const auto& pair_ : _table[state_])
+            {
+                if (pair_.second.action != action::go_to)
+                    return npos();
+            }
+
+            return default_.param;
+        }
     };
 
     // Uses uncompressed 2d array for state machine
@@ -59,6 +59,7 @@
 #include "ext/standard/info.h"
 #include "zend_exceptions.h"
 #include "zend_interfaces.h"
+#include "zend_smart_str.h"
 #include "php_parle.h"
 
 #ifdef HAVE_PARLE_UTF32
@@ -67,6 +68,12 @@
 #define PARLE_U32 0
 #endif
 
+#ifdef HAVE_PARLE_STATS
+#define PARLE_STATS_ON 1
+#else
+#define PARLE_STATS_ON 0
+#endif
+
 /* {{{ Class entries and handlers declarations. */
 zend_object_handlers parle_lexer_handlers;
 zend_object_handlers parle_rlexer_handlers;
@@ -111,7 +118,14 @@ namespace parle {/*{{{*/
 }/* }}} */
 
 #include "parle/cvt.hpp"
+#include "parle/cache.hpp"
+#include "parle/memory.hpp"
 #include "parle/lexer/iterator.hpp"
+#include "parle/lexer/keywords.hpp"
+#include "parle/lexer/tokenize.hpp"
+#include "parle/parser/search.hpp"
+#include "parle/parser/validate.hpp"
+#include "parle/stats.hpp"
 
 #undef lookup
 
@@ -134,35 +148,68 @@ namespace parle {/*{{{*/
 
 		using cmatch = lexertl::match_results<const char_type *, id_type>;
 		using crmatch = lexertl::recursive_match_results<const char_type *, id_type>;
-		using citerator = iterator<const char_type *, state_machine, cmatch, lexer, token_cb, id_type>;
-		using criterator = iterator<const char_type *, state_machine, crmatch, rlexer, token_cb, id_type>;
+		using citerator = iterator<const char_type *, cmatch, lexer, token_cb, id_type>;
+		using criterator = iterator<const char_type *, crmatch, rlexer, token_cb, id_type>;
 
 		using smatch = lexertl::match_results<string::const_iterator, id_type>;
 		using srmatch = lexertl::recursive_match_results<string::const_iterator, id_type>;
-		using siterator = iterator<string::const_iterator, state_machine, smatch, lexer, token_cb, id_type>;
-		using sriterator = iterator<string::const_iterator, state_machine, srmatch, rlexer, token_cb, id_type>;
+		using siterator = iterator<string::const_iterator, smatch, lexer, token_cb, id_type>;
+		using sriterator = iterator<string::const_iterator, srmatch, rlexer, token_cb, id_type>;
 
 		using generator = lexertl::basic_generator<parle_rules, state_machine>;
 		using debug = lexertl::basic_debug<state_machine, char_type, id_type>;
 
+		// Tables of a built lexer. Never changed once built, a build makes
+		// new ones, so any number of lexers can run over the same tables.
+		struct compiled {
+			state_machine sm;
+			keyword_table<char_type, id_type> keywords;
+		};
+
+		// Rules as pushed, kept to rebuild them with keywords folded.
+		struct pushed_rule {
+			string regex;
+			id_type id;
+			id_type user_id;
+		};
+
 		struct lexer {
-			lexer() : in(PARLE_PRE_U32("")), par(nullptr) {}
+			lexer() : in(PARLE_PRE_U32("")), generation(0), tables(std::make_shared<compiled>()), par(nullptr) {}
+			const state_machine &sm() const { return tables->sm; }
+			const keyword_table<char_type, id_type> &keywords() const { return tables->keywords; }
 			string in;
+			// Bumped whenever in is replaced, parser checkpoints taken
+			// before point into the old input.
+			size_t generation;
 			parle_rules rules;
-			state_machine sm;
+			std::shared_ptr<const compiled> tables;
 			parle::parser::parser *par;
 			siterator iter;
 			siterator::cb_map cb_map;
+			std::vector<siterator::checkpoint_type> checkpoints;
+			std::vector<pushed_rule> pushed;
+			// Rule definitions in call order, keys the build cache.
+			std::string defs;
+			parle::stats::lexer_stats stats;
 		};
 
 		struct rlexer {
-			rlexer() : in(PARLE_PRE_U32("")), par(nullptr) {}
+			rlexer() : in(PARLE_PRE_U32("")), generation(0), tables(std::make_shared<compiled>()), par(nullptr) {}
+			const state_machine &sm() const { return tables->sm; }
+			const keyword_table<char_type, id_type> &keywords() const { return tables->keywords; }
 			string in;
+			// Bumped whenever in is replaced, parser checkpoints taken
+			// before point into the old input.
+			size_t generation;
 			parle_rules rules;
-			state_machine sm;
+			std::shared_ptr<const compiled> tables;
 			parle::parser::rparser *par;
 			sriterator iter;
 			sriterator::cb_map cb_map;
+			std::vector<sriterator::checkpoint_type> checkpoints;
+			// Rule definitions in call order, keys the build cache.
+			std::string defs;
+			parle::stats::lexer_stats stats;
 		};
 	}
 
@@ -173,24 +220,54 @@ namespace parle {/*{{{*/
 		using generator = parsertl::basic_generator<parle_rules, state_machine, id_type>;
 		using parle_productions = parsertl::token<parle::lexer::siterator>::token_vector;
 		using parle_rproductions = parsertl::token<parle::lexer::sriterator>::token_vector;
-		using debug = parsertl::basic_debug<char_type>;
+		using debug = parsertl::basic_debug<char_type, id_type>;
+
+		// Parser::build() flags, see Parser::DEFAULT_REDUCTIONS.
+		enum build_flags {
+			default_reductions = 1,
+			eliminate_unit_rules = 2,
+			compress_table = 4,
+		};
+
+		template<typename lexer_iterator, typename productions_type>
+		struct checkpoint {
+			typename lexer_iterator::checkpoint_type lex;
+			match_results results;
+			productions_type productions;
+			size_t generation;
+		};
+
+		// Tables of a built parser, see lexer::compiled.
+		struct compiled {
+			state_machine sm;
+		};
 
 		struct parser {
-			parser() : lex(nullptr) {}
+			parser() : rules(*parsertl::rule_flags::enable_captures), tables(std::make_shared<compiled>()), lex(nullptr) {}
+			const state_machine &sm() const { return tables->sm; }
 			parle_rules rules;
-			state_machine sm;
+			std::shared_ptr<const compiled> tables;
 			match_results results;
 			parle::lexer::lexer *lex;
 			parle_productions productions;
+			std::vector<checkpoint<parle::lexer::siterator, parle_productions>> checkpoints;
+			// Rule definitions in call order, keys the build cache.
+			std::string defs;
+			parle::stats::parser_stats stats;
 		};
 
 		struct rparser {
-			rparser() : lex(nullptr) {}
+			rparser() : rules(*parsertl::rule_flags::enable_captures), tables(std::make_shared<compiled>()), lex(nullptr) {}
+			const state_machine &sm() const { return tables->sm; }
 			parle_rules rules;
-			state_machine sm;
+			std::shared_ptr<const compiled> tables;
 			match_results results;
 			parle::lexer::rlexer *lex;
 			parle_rproductions productions;
+			std::vector<checkpoint<parle::lexer::sriterator, parle_rproductions>> checkpoints;
+			// Rule definitions in call order, keys the build cache.
+			std::string defs;
+			parle::stats::parser_stats stats;
 		};
 	}
 
@@ -199,9 +276,7 @@ namespace parle {/*{{{*/
 	}
 }/*}}}*/
 
-/* If you declare any globals in php_parle.h uncomment this:
 ZEND_DECLARE_MODULE_GLOBALS(parle)
-*/
 
 /* True global resources - no need for thread safety here */
 /* static int le_parle; */
@@ -303,7 +378,9 @@ PHP_METHOD(ParleLexer, push)
 		// Rules for INITIAL
 		auto &lex = *zplo->lex;
 		if (user_id < 0) user_id = lex.iter->npos();
+		parle::cache::record(lex.defs, {"push", ZSTR_VAL(regex), std::to_string(id), std::to_string(user_id)});
 		lex.rules.push(PARLE_CVT_U32(ZSTR_VAL(regex)), static_cast<parle::id_type>(id), static_cast<parle::id_type>(user_id));
+		lex.pushed.push_back({PARLE_SCVT_U32(ZSTR_VAL(regex)), static_cast<parle::id_type>(id), static_cast<parle::id_type>(user_id)});
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
 	}
@@ -327,14 +404,17 @@ PHP_METHOD(ParleRLexer, push)
 		// Rules for INITIAL
 		if(zend_parse_method_parameters_ex(ZEND_PARSE_PARAMS_QUIET, ZEND_NUM_ARGS(), getThis(), "OSl|l", &me, ParleRLexer_ce, &regex, &id, &user_id) == SUCCESS) {
 			PREPARE_PUSH()
+			parle::cache::record(lex.defs, {"push", ZSTR_VAL(regex), std::to_string(id), std::to_string(user_id)});
 			lex.rules.push(PARLE_CVT_U32(ZSTR_VAL(regex)), static_cast<parle::id_type>(id), static_cast<parle::id_type>(user_id));
 		// Rules with id
 		} else if(zend_parse_method_parameters_ex(ZEND_PARSE_PARAMS_QUIET, ZEND_NUM_ARGS(), getThis(), "OSSlS|l", &me, ParleRLexer_ce, &dfa, &regex, &id, &new_dfa, &user_id) == SUCCESS) {
 			PREPARE_PUSH()
+			parle::cache::record(lex.defs, {"push", ZSTR_VAL(dfa), ZSTR_VAL(regex), std::to_string(id), ZSTR_VAL(new_dfa), std::to_string(user_id)});
 			lex.rules.push(PARLE_CVT_U32(ZSTR_VAL(dfa)), PARLE_CVT_U32(ZSTR_VAL(regex)), static_cast<parle::id_type>(id), PARLE_CVT_U32(ZSTR_VAL(new_dfa)), static_cast<parle::id_type>(user_id));
 		// Rules without id
 		} else if(zend_parse_method_parameters_ex(ZEND_PARSE_PARAMS_QUIET, ZEND_NUM_ARGS(), getThis(), "OSSS", &me, ParleRLexer_ce, &dfa, &regex, &new_dfa) == SUCCESS) {
 			PREPARE_PUSH()
+			parle::cache::record(lex.defs, {"push", ZSTR_VAL(dfa), ZSTR_VAL(regex), ZSTR_VAL(new_dfa)});
 			lex.rules.push(PARLE_CVT_U32(ZSTR_VAL(dfa)), PARLE_CVT_U32(ZSTR_VAL(regex)), PARLE_CVT_U32(ZSTR_VAL(new_dfa)));
 		} else {
 			zend_throw_exception(ParleLexerException_ce, "Couldn't match the method signature", 0);
@@ -389,6 +469,38 @@ PHP_METHOD(ParleRLexer, callout)
 /* }}} */
 
 /* }}} */
+/* Build through parle.cache_dir when it's set. The tables are loaded from
+	there if they were stored for the same definitions, otherwise they are
+	built and stored for the next process. Either way they go into a new
+	compiled object, the lexer only switches to it once it's complete. */
+template<typename lexer_type, typename build_type> void
+_lexer_build_cached(lexer_type &lex, const char *kind, const std::string &defs, build_type build)
+{/*{{{*/
+	const char *dir = PARLE_G(cache_dir);
+	auto &phases = lex.stats.build;
+	auto tables = std::make_shared<parle::lexer::compiled>();
+	auto build_tables = [&build, &tables]() {
+		build(*tables);
+	};
+
+	phases.clear();
+	if (!dir || !*dir) {
+		parle::stats::phase(phases, "build", build_tables);
+	} else {
+		std::string file = parle::cache::path(dir, kind, defs), data;
+
+		if (!parle::stats::phase(phases, "cache_read", [&]() {
+			return parle::cache::read(file, data) && parle::cache::load_lexer(data, defs, tables->sm, tables->keywords);
+		})) {
+			parle::stats::phase(phases, "build", build_tables);
+			parle::stats::phase(phases, "cache_write", [&]() {
+				parle::cache::write(file, parle::cache::dump_lexer(defs, tables->sm, tables->keywords));
+			});
+		}
+	}
+	lex.tables = std::move(tables);
+}/*}}}*/
+
 template<typename lexer_obj_type> void
 _lexer_build(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
@@ -404,16 +516,46 @@ _lexer_build(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 	auto &lex = *zplo->lex;
 
 	try {
-		parle::lexer::generator::build(lex.rules, lex.sm);
+		std::string defs = lex.defs;
+
+		parle::cache::record(defs, {"build", std::to_string(lex.rules.flags())});
+		_lexer_build_cached(lex, "rlexer", defs, [&lex](parle::lexer::compiled &tables) {
+			parle::lexer::generator::build(lex.rules, tables.sm);
+		});
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
 	}
 }/*}}}*/
 
-/* {{{ public void Lexer::build(void) */
+/* {{{ public void Lexer::build([bool $foldKeywords = false]) */
 PHP_METHOD(ParleLexer, build)
 {
-	_lexer_build<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+	ze_parle_lexer_obj *zplo;
+	zval *me;
+	zend_bool fold = 0;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O|b", &me, ParleLexer_ce, &fold) == FAILURE) {
+		return;
+	}
+
+	zplo = php_parle_lexer_fetch_obj(Z_OBJ_P(me));
+
+	auto &lex = *zplo->lex;
+
+	try {
+		std::string defs = lex.defs;
+
+		parle::cache::record(defs, {"build", std::to_string(lex.rules.flags()), fold ? "1" : "0"});
+		_lexer_build_cached(lex, "lexer", defs, [&lex, fold](parle::lexer::compiled &tables) {
+			/* Literal rules the identifier rule matches anyway are looked up
+				after the match instead of being compiled into the DFA. */
+			if (!fold || !parle::lexer::build_folded<parle::lexer::generator, parle::lexer::smatch>(lex.rules, lex.pushed, tables.sm, tables.keywords)) {
+				parle::lexer::generator::build(lex.rules, tables.sm);
+			}
+		});
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+	}
 }
 /* }}} */
 
@@ -442,7 +584,9 @@ _lexer_consume(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		lex.in = PARLE_CVT_U32(in);
+		lex.generation++;
 		lex.iter = {lex.in.begin(), lex.in.end(), lex};
+		lex.checkpoints.clear();
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
 	}
@@ -478,6 +622,7 @@ PHP_METHOD(ParleRLexer, pushState)
 
 	try {
 		auto &rules = zplo->lex->rules;
+		parle::cache::record(zplo->lex->defs, {"pushState", state});
 		RETURN_LONG(rules.push_state(PARLE_CVT_U32(state)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
@@ -570,9 +715,10 @@ _lexer_reset(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
 	lexer_obj_type *zplo;
 	zval *me;
-	zend_long pos;
+	zend_long pos, state = -1;
+	zend_bool bol = 0, bol_is_null = 1;
 
-	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "Ol", &me, ce, &pos) == FAILURE) {
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "Ol|lb!", &me, ce, &pos, &state, &bol, &bol_is_null) == FAILURE) {
 		return;
 	}
 
@@ -583,34 +729,466 @@ _lexer_reset(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 	if (pos < 0 || static_cast<size_t>(pos) > lex.in.length()) {
 		zend_throw_exception_ex(ParleLexerException_ce, 0, "Invalid offset " ZEND_LONG_FMT, pos);
 		return;
+	} else if (state >= 0 && (lex.sm().empty() || static_cast<size_t>(state) >= lex.sm().data()._dfa.size())) {
+		zend_throw_exception_ex(ParleLexerException_ce, 0, "Invalid state " ZEND_LONG_FMT, state);
+		return;
 	}
 
 	try {
-		//if (lex.par) {
-			/* Don't replace iter as it's passed to the parser already.*/
-			lex.iter.reset(lex.in.begin() + static_cast<size_t>(pos), lex.in.end());
-		//} else {
-		//	lex.iter = {lex.in.begin() + static_cast<size_t>(pos), lex.in.end(), lex};
-		//}
+		auto start = lex.in.begin() + static_cast<size_t>(pos);
+		bool backwards = start < lex.iter->first;
+		/* Don't replace iter as it's passed to the parser already.*/
+		if (backwards || state >= 0 || !bol_is_null) {
+			/* Restarting at an earlier or given position. Unless
+				supplied, bol is derived from the input. The current state
+				is the one at the later position, so going back without a
+				state starts in INITIAL. This only moves the lexer, there's
+				no incremental parsing: a parser resumes on the same input
+				only, see Parser::restore(). */
+			if (bol_is_null) {
+				bol = 0 == pos || '\n' == *(start - 1);
+			}
+			if (state < 0) {
+				state = backwards ? 0 : lex.iter->state;
+			}
+			lex.iter.restart(lex.in.begin(), start, lex.in.end(), static_cast<parle::id_type>(state), bol);
+		} else {
+			lex.iter.reset(start, lex.in.end());
+		}
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
 	}
 }/*}}}*/
 
-/* {{{ public void Lexer::reset(int $position) */
+/* {{{ public void Lexer::reset(int $position [, int $state [, ?bool $bol]]) */
 PHP_METHOD(ParleLexer, reset)
 {
 	_lexer_reset<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
 }
 /* }}} */
 
-/* {{{ public void RLexer::reset(int $position) */
+/* {{{ public void RLexer::reset(int $position [, int $state [, ?bool $bol]]) */
 PHP_METHOD(ParleRLexer, reset)
 {
 	_lexer_reset<ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
 }
 /* }}} */
 
+template<typename lexer_obj_type> void
+_lexer_checkpoint(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	lexer_obj_type *zplo;
+	zval *me;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O", &me, ce) == FAILURE) {
+		return;
+	}
+
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(me));
+
+	try {
+		auto &lex = *zplo->lex;
+		lex.checkpoints.push_back(lex.iter.checkpoint());
+		RETURN_LONG(static_cast<zend_long>(lex.checkpoints.size() - 1));
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public int Lexer::checkpoint(void) */
+PHP_METHOD(ParleLexer, checkpoint)
+{
+	_lexer_checkpoint<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public int RLexer::checkpoint(void) */
+PHP_METHOD(ParleRLexer, checkpoint)
+{
+	_lexer_checkpoint<ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
+}
+/* }}} */
+
+template<typename lexer_obj_type> void
+_lexer_restore(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	lexer_obj_type *zplo;
+	zval *me;
+	zend_long id;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "Ol", &me, ce, &id) == FAILURE) {
+		return;
+	}
+
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(me));
+
+	auto &lex = *zplo->lex;
+
+	if (id < 0 || static_cast<size_t>(id) >= lex.checkpoints.size()) {
+		zend_throw_exception_ex(ParleLexerException_ce, 0, "Invalid checkpoint " ZEND_LONG_FMT, id);
+		return;
+	}
+
+	try {
+		/* Later checkpoints are discarded, the restored one stays usable. */
+		lex.checkpoints.resize(static_cast<size_t>(id) + 1);
+		lex.iter.restore(lex.checkpoints.back());
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public void Lexer::restore(int $id) */
+PHP_METHOD(ParleLexer, restore)
+{
+	_lexer_restore<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public void RLexer::restore(int $id) */
+PHP_METHOD(ParleRLexer, restore)
+{
+	_lexer_restore<ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
+}
+/* }}} */
+
+template<typename lexer_obj_type> void
+_lexer_tokenize(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	lexer_obj_type *zplo;
+	zval *me;
+	zend_long threads = 0;
+	zend_string *resync = nullptr;
+	zend_bool speculative = 0;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O|lS!b", &me, ce, &threads, &resync, &speculative) == FAILURE) {
+		return;
+	}
+
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(me));
+
+	auto &lex = *zplo->lex;
+	using results = typename decltype(lex.iter)::value_type;
+
+	if (lex.sm().empty()) {
+		zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
+		return;
+	} else if (!lex.cb_map.empty()) {
+		zend_throw_exception(ParleLexerException_ce, "Callouts are not supported by tokenize()", 0);
+		return;
+	} else if (speculative && resync) {
+		zend_throw_exception(ParleLexerException_ce, "Resync pattern can't be used with speculative lexing", 0);
+		return;
+	}
+
+	try {
+		const auto begin = lex.in.cbegin(), end = lex.in.cend();
+		size_t chunks = threads > 0 ? static_cast<size_t>(threads) : std::thread::hardware_concurrency();
+		std::vector<parle::lexer::token_span<parle::id_type>> tokens;
+
+		chunks = std::max<size_t>(1, std::min(chunks, lex.in.size() / parle::lexer::tokenize_min_chunk));
+
+		if (speculative) {
+			/* No safe split points, chunks are fixed up after the fact. */
+			tokens = parle::lexer::tokenize_speculative<results>(lex.sm(), lex.keywords(), begin, end, chunks);
+		} else {
+			std::vector<parle::string::const_iterator> bounds;
+
+			if (resync) {
+				/* Split at the positions where the resync pattern matches. */
+				parle::lexer::parle_rules rules;
+				parle::lexer::state_machine sm;
+
+				rules.flags(lex.rules.flags());
+				rules.push(PARLE_CVT_U32(ZSTR_VAL(resync)), 1);
+				parle::lexer::generator::build(rules, sm);
+
+				bounds = parle::lexer::split(begin, end, chunks, [&sm, &end](parle::string::const_iterator pos) {
+					for (; pos != end; ++pos) {
+						parle::lexer::smatch m(pos, end, '\n' == *(pos - 1));
+						lexertl::lookup(sm, m);
+						if (1 == m.id) {
+							break;
+						}
+					}
+					return pos;
+				});
+			} else {
+				/* Split right after a newline, the lexer is at bol there. A
+					token running across it, f.e. a quoted field or a comment,
+					is lexed again across the seam when the chunks are joined. */
+				bounds = parle::lexer::split(begin, end, chunks, [&end](parle::string::const_iterator pos) {
+					pos = std::find(pos, end, '\n');
+					return pos == end ? end : pos + 1;
+				});
+			}
+
+			tokens = parle::lexer::tokenize<results>(lex.sm(), lex.keywords(), bounds);
+		}
+
+		array_init_size(return_value, static_cast<uint32_t>(tokens.size()));
+		for (auto &t : tokens) {
+			zval tok;
+			array_init_size(&tok, 3);
+			add_next_index_long(&tok, static_cast<zend_long>(t.id));
+			add_next_index_long(&tok, static_cast<zend_long>(t.first));
+			add_next_index_long(&tok, static_cast<zend_long>(t.second));
+			add_next_index_zval(return_value, &tok);
+		}
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public array Lexer::tokenize([int $threads [, ?string $resync [, bool $speculative]]]) */
+PHP_METHOD(ParleLexer, tokenize)
+{
+	_lexer_tokenize<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public array RLexer::tokenize([int $threads [, ?string $resync [, bool $speculative]]]) */
+PHP_METHOD(ParleRLexer, tokenize)
+{
+	_lexer_tokenize<ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
+}
+/* }}} */
+
+/* Output of replace(), spans of the input are copied straight into the buffer. */
+struct replace_buffer
+{
+	smart_str buf = {};
+
+	void append(const parle::char_type *first, const parle::char_type *last)
+	{
+#if PARLE_U32
+		std::string s8 = PARLE_SCVT_U8(parle::string(first, last));
+		smart_str_appendl(&buf, s8.c_str(), s8.size());
+#else
+		smart_str_appendl(&buf, first, last - first);
+#endif
+	}
+
+	void append(zend_string *str)
+	{
+		smart_str_append(&buf, str);
+	}
+};
+
+template<typename lexer_obj_type, typename results> void
+_lexer_replace(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	lexer_obj_type *zplo;
+	zval *me, *zrepl, *val;
+	zend_string *in, *key;
+	zend_ulong h;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "OSa", &me, ce, &in, &zrepl) == FAILURE) {
+		return;
+	}
+
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(me));
+
+	auto &lex = *zplo->lex;
+
+	if (lex.sm().empty()) {
+		zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
+		return;
+	}
+
+	std::unordered_map<parle::id_type, zend_string *> replacements;
+	replace_buffer out;
+
+	ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(zrepl), h, key, val) {
+		if (key) {
+			zend_throw_exception(ParleLexerException_ce, "Replacements must be indexed by token id", 0);
+			break;
+		} else if (h > static_cast<zend_ulong>(parle::lexer::cmatch::npos())) {
+			zend_throw_exception(ParleLexerException_ce, "Token id is out of range", 0);
+			break;
+		}
+		replacements.emplace(static_cast<parle::id_type>(h), zval_get_string(val));
+	} ZEND_HASH_FOREACH_END();
+
+	if (!EG(exception)) {
+		try {
+#if PARLE_U32
+			const parle::string data{PARLE_CVT_U32(ZSTR_VAL(in))};
+			const parle::char_type *begin = data.data(), *end = begin + data.size();
+#else
+			const parle::char_type *begin = ZSTR_VAL(in), *end = begin + ZSTR_LEN(in);
+#endif
+
+			/* Most tokens are usually kept, start with room for the whole input. */
+			smart_str_alloc(&out.buf, ZSTR_LEN(in), 0);
+			parle::lexer::replace<results>(lex.sm(), lex.keywords(), begin, end, replacements, out);
+			smart_str_0(&out.buf);
+			RETVAL_STR(out.buf.s);
+			out.buf.s = nullptr;
+		} catch (const std::exception &e) {
+			php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+		}
+	}
+
+	smart_str_free(&out.buf);
+	for (auto &r : replacements) {
+		zend_string_release(r.second);
+	}
+}/*}}}*/
+
+/* {{{ public string Lexer::replace(string $data, array $replacements) */
+PHP_METHOD(ParleLexer, replace)
+{
+	_lexer_replace<ze_parle_lexer_obj, parle::lexer::cmatch>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public string RLexer::replace(string $data, array $replacements) */
+PHP_METHOD(ParleRLexer, replace)
+{
+	_lexer_replace<ze_parle_rlexer_obj, parle::lexer::crmatch>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
+}
+/* }}} */
+
+static void
+php_parle_stats_phases(zval *ret, const parle::stats::phases &phases) noexcept
+{/*{{{*/
+	zval build;
+
+	array_init(&build);
+	for (auto &ph : phases) {
+		add_assoc_double_ex(&build, ph.first.c_str(), ph.first.size(), ph.second);
+	}
+	add_assoc_zval_ex(ret, "build", sizeof("build") - 1, &build);
+}/*}}}*/
+
+template<typename lexer_obj_type> void
+_lexer_stats(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	lexer_obj_type *zplo;
+	zval *me;
+	zend_bool reset = 0;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O|b", &me, ce, &reset) == FAILURE) {
+		return;
+	}
+
+#ifdef HAVE_PARLE_STATS
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(me));
+
+	auto &stats = zplo->lex->stats;
+	zval tokens;
+
+	array_init(return_value);
+	array_init_size(&tokens, static_cast<uint32_t>(stats.tokens.size()));
+	for (auto &t : stats.tokens) {
+		add_index_long(&tokens, static_cast<zend_ulong>(t.first), static_cast<zend_long>(t.second));
+	}
+	add_assoc_zval_ex(return_value, "tokens", sizeof("tokens") - 1, &tokens);
+	add_assoc_long_ex(return_value, "bytes", sizeof("bytes") - 1, static_cast<zend_long>(stats.bytes));
+	add_assoc_long_ex(return_value, "callouts", sizeof("callouts") - 1, static_cast<zend_long>(stats.callouts));
+	add_assoc_double_ex(return_value, "callout_time", sizeof("callout_time") - 1, stats.callout_time);
+	php_parle_stats_phases(return_value, stats.build);
+
+	if (reset) {
+		stats.reset();
+	}
+#else
+	(void)zplo;
+	RETURN_NULL();
+#endif
+}/*}}}*/
+
+/* {{{ public ?array Lexer::stats([bool $reset = false]) */
+PHP_METHOD(ParleLexer, stats)
+{
+	_lexer_stats<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public ?array RLexer::stats([bool $reset = false]) */
+PHP_METHOD(ParleRLexer, stats)
+{
+	_lexer_stats<ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
+}
+/* }}} */
+
+static size_t
+php_parle_pushed_memory(const parle::lexer::lexer &lex) noexcept
+{/*{{{*/
+	size_t ret = lex.pushed.capacity() * sizeof(parle::lexer::pushed_rule);
+
+	for (auto &r : lex.pushed) {
+		ret += parle::memory::heap(r.regex);
+	}
+
+	return ret;
+}/*}}}*/
+
+static size_t
+php_parle_pushed_memory(const parle::lexer::rlexer &) noexcept
+{/*{{{*/
+	return 0;
+}/*}}}*/
+
+/* Fill the array with the components and their total. */
+static void
+php_parle_memory_usage(zval *ret, const std::vector<std::pair<const char *, size_t>> &parts) noexcept
+{/*{{{*/
+	size_t total = 0;
+
+	array_init_size(ret, static_cast<uint32_t>(parts.size() + 1));
+	for (auto &part : parts) {
+		add_assoc_long_ex(ret, part.first, strlen(part.first), static_cast<zend_long>(part.second));
+		total += part.second;
+	}
+	add_assoc_long_ex(ret, "total", sizeof("total") - 1, static_cast<zend_long>(total));
+}/*}}}*/
+
+template<typename lexer_obj_type> void
+_lexer_memory_usage(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	lexer_obj_type *zplo;
+	zval *me;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O", &me, ce) == FAILURE) {
+		return;
+	}
+
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(me));
+
+	auto &lex = *zplo->lex;
+
+	try {
+		using parle::memory::heap;
+
+		php_parle_memory_usage(return_value, {
+			{"rules", parle::memory::lexer_rules(lex.rules) + php_parle_pushed_memory(lex) + heap(lex.defs) + heap(lex.cb_map)},
+			{"dfa", parle::memory::lexer_dfa(lex.sm())},
+			{"lookup", parle::memory::lexer_lookup(lex.sm())},
+			{"keywords", lex.keywords().memory()},
+			{"input", heap(lex.in)},
+			{"checkpoints", lex.checkpoints.capacity() * sizeof(typename decltype(lex.checkpoints)::value_type)},
+		});
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public array Lexer::memoryUsage(void) */
+PHP_METHOD(ParleLexer, memoryUsage)
+{
+	_lexer_memory_usage<ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public array RLexer::memoryUsage(void) */
+PHP_METHOD(ParleRLexer, memoryUsage)
+{
+	_lexer_memory_usage<ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRLexer_ce);
+}
+/* }}} */
+
 template<typename lexer_obj_type> void
 _lexer_macro(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
@@ -626,6 +1204,7 @@ _lexer_macro(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &lex = *zplo->lex;
+		parle::cache::record(lex.defs, {"insertMacro", ZSTR_VAL(name), ZSTR_VAL(regex)});
 		lex.rules.insert_macro(PARLE_CVT_U32(ZSTR_VAL(name)), PARLE_CVT_U32(ZSTR_VAL(regex)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
@@ -665,7 +1244,7 @@ _lexer_dump(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 		std::basic_stringstream<parle::char_type> ss;
 		parle::string str;
 
-		parle::lexer::debug::dump(lex.sm, lex.rules, ss);
+		parle::lexer::debug::dump(lex.sm(), lex.rules, ss);
 		str = ss.str();
 
 		const parle::char_type* end_str = str.c_str() + str.size();
@@ -678,7 +1257,7 @@ _lexer_dump(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 		std::stringstream ss;
 		std::string str;
 
-		parle::lexer::debug::dump(lex.sm, lex.rules, ss);
+		parle::lexer::debug::dump(lex.sm(), lex.rules, ss);
 		str = ss.str();
 		php_write((void*)str.c_str(), str.size());
 #endif
@@ -730,6 +1309,7 @@ _parser_token(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"token", ZSTR_VAL(tok)});
 		rules.token(PARLE_CVT_U32(ZSTR_VAL(tok)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
@@ -765,6 +1345,7 @@ _parser_left(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"left", ZSTR_VAL(tok)});
 		rules.left(PARLE_CVT_U32(ZSTR_VAL(tok)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
@@ -801,6 +1382,7 @@ _parser_right(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"right", ZSTR_VAL(tok)});
 		rules.right(PARLE_CVT_U32(ZSTR_VAL(tok)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
@@ -836,6 +1418,7 @@ _parser_precedence(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"precedence", ZSTR_VAL(tok)});
 		rules.precedence(PARLE_CVT_U32(ZSTR_VAL(tok)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
@@ -871,6 +1454,7 @@ _parser_nonassoc(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"nonassoc", ZSTR_VAL(tok)});
 		rules.nonassoc(PARLE_CVT_U32(ZSTR_VAL(tok)));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
@@ -896,8 +1480,9 @@ _parser_build(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
 	parser_obj_type *zppo;
 	zval *me;
+	zend_long flags = 0;
 
-	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O", &me, ce) == FAILURE) {
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O|l", &me, ce, &flags) == FAILURE) {
 		return;
 	}
 
@@ -905,20 +1490,73 @@ _parser_build(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &par = *zppo->par;
-		parle::parser::generator::build(par.rules, par.sm);
+		auto &phases = par.stats.build;
+		/* Built aside like the lexer tables, see _lexer_build_cached(). */
+		auto tables = std::make_shared<parle::parser::compiled>();
+		auto &sm = tables->sm;
+		const char *dir = PARLE_G(cache_dir);
+		auto build = [&par, &sm, &phases, flags]() {
+			parle::stats::phase(phases, "lalr", [&par, &sm]() {
+				parle::parser::generator::build(par.rules, sm);
+			});
+			/* Both only change what advance() and validate() step through,
+				the accepted language stays the same. */
+			if (flags & (parle::parser::default_reductions | parle::parser::eliminate_unit_rules)) {
+				parle::stats::phase(phases, "default_reductions", [&sm]() {
+					sm.default_reductions();
+				});
+			}
+			if (flags & parle::parser::eliminate_unit_rules) {
+				parle::stats::phase(phases, "eliminate_unit_rules", [&sm]() {
+					sm.eliminate_unit_rules();
+				});
+			}
+		};
+
+		phases.clear();
+		if (!dir || !*dir) {
+			build();
+		} else {
+			/* Same as in _lexer_build_cached(). The rules still need what
+				validate() adds when the tables come from the cache. */
+			std::string defs = par.defs;
+
+			parle::cache::record(defs, {"build", std::to_string(flags)});
+
+			std::string file = parle::cache::path(dir, "parser", defs), data;
+
+			par.rules.validate();
+			if (!parle::stats::phase(phases, "cache_read", [&]() {
+				return parle::cache::read(file, data) && parle::cache::load_parser<parle::char_type>(data, defs, sm);
+			})) {
+				build();
+				parle::stats::phase(phases, "cache_write", [&]() {
+					parle::cache::write(file, parle::cache::dump_parser<parle::char_type>(defs, sm));
+				});
+			}
+		}
+
+		/* Last, the cache keeps the rows. */
+		if (flags & parle::parser::compress_table) {
+			parle::stats::phase(phases, "compress", [&sm]() {
+				sm.compress();
+			});
+		}
+
+		par.tables = std::move(tables);
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
 	}
 }/*}}}*/
 
-/* {{{ public void Parser::build(void) */
+/* {{{ public void Parser::build([int $flags = 0]) */
 PHP_METHOD(ParleParser, build)
 {
 	_parser_build<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
 }
 /* }}} */
 
-/* {{{ public void RParser::build(void) */
+/* {{{ public void RParser::build([int $flags = 0]) */
 PHP_METHOD(ParleRParser, build)
 {
 	_parser_build<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
@@ -940,6 +1578,7 @@ _parser_push(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"push", ZSTR_VAL(lhs), ZSTR_VAL(rhs)});
 		RETURN_LONG(static_cast<zend_long>(rules.push(PARLE_CVT_U32(ZSTR_VAL(lhs)), PARLE_CVT_U32(ZSTR_VAL(rhs)))));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
@@ -979,19 +1618,52 @@ _parser_validate(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *par_ce, zend_cl
 		auto &par = *zppo->par;
 		par.lex = zplo->lex;
 		auto &lex = *par.lex;
-		if (lex.sm.empty()) {
+		if (lex.sm().empty()) {
 			zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
 			return;
-		} else if (par.sm.empty()) {
+		} else if (par.sm().empty()) {
 			zend_throw_exception(ParleParserException_ce, "Parser state machine is empty", 0);
 			return;
 		}
 		lex.in = PARLE_SCVT_U32(ZSTR_VAL(in));
-		lex.iter = {lex.in.begin(), lex.in.end(), lex, true};
+		lex.generation++;
+		lex.checkpoints.clear();
 		lex.par = zppo->par;
-		par.productions = {};
-		par.results = {lex.iter->id, par.sm};
-		RETURN_BOOL(parsertl::parse(lex.iter, par.sm, par.results));
+		/* Clear rather than reassign, so the buffers keep their capacity
+			from earlier inputs and a parse runs without allocating. */
+		par.productions.clear();
+		par.checkpoints.clear();
+
+		if (lex.cb_map.empty()) {
+			using results = typename decltype(lex.iter)::value_type;
+			parle::lexer::token_entry<parle::id_type> at;
+			parle::parser::position where;
+			parle::stats::pending counted;
+			bool ret = parle::parser::validate<results>(lex.sm(), lex.keywords(), par.sm(), lex.in.cbegin(), lex.in.cend(), par.results, at, where,
+				parle::parser::no_snapshot(), parle::stats::counter_for(counted));
+
+			/* Leave the lexer on the last token, as after a run through
+				the iterator. A recursive lexer can't be put into a pushed
+				state, that rare case is run again below. */
+			if (0 == at.depth) {
+				/* Counted aside so the run below doesn't count twice. */
+				counted.commit(lex, par);
+				lex.iter = {lex.in.begin(), lex.in.end(), lex};
+				lex.iter.restart(lex.in.begin() + at.pos, lex.in.end(), at.state, at.bol, where.line, where.column);
+				++lex.iter;
+				/* The lookup above repeats the last one of validate(). */
+				PARLE_STATS(lex.stats.untoken(lex.iter->id, lex.iter->second - lex.iter->first));
+				RETURN_BOOL(ret);
+			}
+		}
+
+		/* Callouts run PHP code, which may build the parser again. Keep the
+			tables the parse started with alive until it's done. */
+		auto tables = par.tables;
+
+		lex.iter = {lex.in.begin(), lex.in.end(), lex, true};
+		par.results.reset(lex.iter->id, tables->sm);
+		RETURN_BOOL(parle::stats::parse(lex.iter, tables->sm, par.results, par.stats));
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
 	}
@@ -1013,6 +1685,235 @@ PHP_METHOD(ParleRParser, validate)
 }
 /* }}} */
 
+template<typename parser_obj_type, typename lexer_obj_type> void
+_parser_validateMany(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *par_ce, zend_class_entry *lex_ce) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	lexer_obj_type *zplo;
+	zval *me, *zin, *zlex, *val;
+	zend_long threads = 1;
+	zend_ulong h;
+	zend_string *key;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "OaO|l", &me, par_ce, &zin, &zlex, lex_ce, &threads) == FAILURE) {
+		return;
+	}
+
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(zlex));
+
+	try {
+		auto &par = *zppo->par;
+		par.lex = zplo->lex;
+		auto &lex = *par.lex;
+		size_t chunks = threads > 0 ? static_cast<size_t>(threads) : std::thread::hardware_concurrency();
+
+		if (lex.sm().empty()) {
+			zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
+			return;
+		} else if (par.sm().empty()) {
+			zend_throw_exception(ParleParserException_ce, "Parser state machine is empty", 0);
+			return;
+		} else if (chunks > 1 && !lex.cb_map.empty()) {
+			zend_throw_exception(ParleLexerException_ce, "Callouts are not supported with multiple threads", 0);
+			return;
+		}
+
+		const size_t n = zend_hash_num_elements(Z_ARRVAL_P(zin));
+		std::vector<parle::string> inputs;
+		std::vector<std::pair<zend_ulong, zend_string *>> keys;
+		std::vector<char> valid(n, 0);
+
+		/* Convert upfront, the threads must not touch zvals. */
+		inputs.reserve(n);
+		keys.reserve(n);
+		ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(zin), h, key, val) {
+			zend_string *str = zval_get_string(val);
+			inputs.emplace_back(PARLE_SCVT_U32(ZSTR_VAL(str)));
+			keys.emplace_back(h, key);
+			zend_string_release(str);
+		} ZEND_HASH_FOREACH_END();
+
+		chunks = std::max<size_t>(1, std::min(chunks, n));
+
+		if (1 == chunks && !lex.cb_map.empty()) {
+			/* Same as validate(), but the parser buffers are kept. */
+			auto tables = par.tables;
+
+			lex.par = zppo->par;
+			for (size_t i = 0; i < n; i++) {
+				lex.in.swap(inputs[i]);
+				lex.generation++;
+				lex.checkpoints.clear();
+				par.checkpoints.clear();
+				lex.iter = {lex.in.begin(), lex.in.end(), lex, true};
+				par.productions.clear();
+				par.results.reset(lex.iter->id, tables->sm);
+				valid[i] = parle::stats::parse(lex.iter, tables->sm, par.results, par.stats);
+				if (EG(exception)) {
+					return;
+				}
+			}
+		} else if (1 == chunks) {
+			/* The fused loop of validate(), counted like there. The
+				lexer input is left alone, as with several threads. */
+			using results = typename decltype(lex.iter)::value_type;
+			decltype(par.results) res;
+			parle::lexer::token_entry<parle::id_type> at;
+			parle::parser::position where;
+			parle::stats::pending counted;
+
+			for (size_t i = 0; i < n; i++) {
+				valid[i] = parle::parser::validate<results>(lex.sm(), lex.keywords(), par.sm(), inputs[i].cbegin(), inputs[i].cend(), res, at, where,
+					parle::parser::no_snapshot(), parle::stats::counter_for(counted));
+			}
+			counted.commit(lex, par);
+		} else {
+			/* No callouts, so the lexer is only read. Every thread
+				runs its own validation. */
+			parle::lexer::parallel_for(chunks, [&](size_t c) {
+				using results = typename decltype(lex.iter)::value_type;
+				decltype(par.results) res;
+				parle::lexer::token_entry<parle::id_type> at;
+				parle::parser::position where;
+
+				for (size_t i = c; i < n; i += chunks) {
+					valid[i] = parle::parser::validate<results>(lex.sm(), lex.keywords(), par.sm(), inputs[i].cbegin(), inputs[i].cend(), res, at, where);
+				}
+			});
+		}
+
+		array_init_size(return_value, static_cast<uint32_t>(n));
+		for (size_t i = 0; i < n; i++) {
+			if (keys[i].second) {
+				add_assoc_bool_ex(return_value, ZSTR_VAL(keys[i].second), ZSTR_LEN(keys[i].second), valid[i]);
+			} else {
+				add_index_bool(return_value, keys[i].first, valid[i]);
+			}
+		}
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public array Parser::validateMany(array $data, Lexer $lexer [, int $threads]) */
+PHP_METHOD(ParleParser, validateMany)
+{
+	_parser_validateMany<ze_parle_parser_obj, ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public array RParser::validateMany(array $data, RLexer $lexer [, int $threads]) */
+PHP_METHOD(ParleRParser, validateMany)
+{
+	_parser_validateMany<ze_parle_rparser_obj, ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce, ParleRLexer_ce);
+}
+/* }}} */
+
+template<typename parser_obj_type, typename lexer_obj_type, typename results> void
+_parser_search(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *par_ce, zend_class_entry *lex_ce, bool all) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	lexer_obj_type *zplo;
+	zval *me, *zlex;
+	zend_string *in;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "OSO", &me, par_ce, &in, &zlex, lex_ce) == FAILURE) {
+		return;
+	}
+
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(zlex));
+
+	auto &par = *zppo->par;
+	auto &lex = *zplo->lex;
+
+	if (lex.sm().empty()) {
+		zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
+		return;
+	} else if (par.sm().empty()) {
+		zend_throw_exception(ParleParserException_ce, "Parser state machine is empty", 0);
+		return;
+	} else if (!lex.cb_map.empty()) {
+		zend_throw_exception(ParleLexerException_ce, "Callouts are not supported by search()", 0);
+		return;
+	}
+
+	/* Captures as lists of [start, end] pairs, the whole match first. */
+	auto to_zval = [](zval *ret, const parle::parser::capture_spans &captures) {
+		array_init_size(ret, static_cast<uint32_t>(captures.size()));
+		for (auto &group : captures) {
+			zval spans;
+			array_init_size(&spans, static_cast<uint32_t>(group.size()));
+			for (auto &span : group) {
+				zval pair;
+				array_init_size(&pair, 2);
+				add_next_index_long(&pair, static_cast<zend_long>(span.first));
+				add_next_index_long(&pair, static_cast<zend_long>(span.second));
+				add_next_index_zval(&spans, &pair);
+			}
+			add_next_index_zval(ret, &spans);
+		}
+	};
+
+	try {
+#if PARLE_U32
+		const parle::string data{PARLE_CVT_U32(ZSTR_VAL(in))};
+		const parle::char_type *begin = data.data(), *end = begin + data.size();
+#else
+		const parle::char_type *begin = ZSTR_VAL(in), *end = begin + ZSTR_LEN(in);
+#endif
+
+		/* Neither the lexer nor the parser state is touched. */
+		if (all) {
+			array_init(return_value);
+		} else {
+			ZVAL_NULL(return_value);
+		}
+		parle::parser::search<results>(lex.sm(), lex.keywords(), par.sm(), begin, end, [&](const parle::parser::capture_spans &captures) {
+			if (!all) {
+				to_zval(return_value, captures);
+				return false;
+			}
+
+			zval match;
+			to_zval(&match, captures);
+			add_next_index_zval(return_value, &match);
+			return true;
+		});
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public ?array Parser::search(string $data, Lexer $lexer) */
+PHP_METHOD(ParleParser, search)
+{
+	_parser_search<ze_parle_parser_obj, ze_parle_lexer_obj, parle::lexer::cmatch>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce, ParleLexer_ce, false);
+}
+/* }}} */
+
+/* {{{ public ?array RParser::search(string $data, RLexer $lexer) */
+PHP_METHOD(ParleRParser, search)
+{
+	_parser_search<ze_parle_rparser_obj, ze_parle_rlexer_obj, parle::lexer::crmatch>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce, ParleRLexer_ce, false);
+}
+/* }}} */
+
+/* {{{ public array Parser::searchAll(string $data, Lexer $lexer) */
+PHP_METHOD(ParleParser, searchAll)
+{
+	_parser_search<ze_parle_parser_obj, ze_parle_lexer_obj, parle::lexer::cmatch>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce, ParleLexer_ce, true);
+}
+/* }}} */
+
+/* {{{ public array RParser::searchAll(string $data, RLexer $lexer) */
+PHP_METHOD(ParleRParser, searchAll)
+{
+	_parser_search<ze_parle_rparser_obj, ze_parle_rlexer_obj, parle::lexer::crmatch>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce, ParleRLexer_ce, true);
+}
+/* }}} */
+
 template <typename parser_obj_type> void
 _parser_tokenId(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
@@ -1066,14 +1967,14 @@ _parser_sigil(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 	if (!_parser_is_in_reduce_state(par)) {
 		return;
 	} else if (idx < Z_L(0) ||
-		par.productions.size() - par.results.production_size(par.sm, par.results.entry.param) + static_cast<size_t>(idx) >= par.productions.size()) {
+		par.productions.size() - par.results.production_size(par.sm(), par.results.entry.param) + static_cast<size_t>(idx) >= par.productions.size()) {
 		zend_throw_exception_ex(ParleParserException_ce, 0, "Invalid index " ZEND_LONG_FMT, idx);
 		return;
 	}
 
 	try {
 		auto &lex = *par.lex;
-		auto ret = par.results.dollar(static_cast<parle::id_type>(idx), par.sm, par.productions);
+		auto ret = par.results.dollar(static_cast<parle::id_type>(idx), par.sm(), par.productions);
 		size_t start_pos = ret.first - lex.in.begin();
 		parle::string r(lex.in, start_pos, ret.second - ret.first);
 		std::string r8 = PARLE_SCVT_U8(r);
@@ -1116,12 +2017,12 @@ _parser_sigil_name(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 		if (!_parser_is_in_reduce_state(par)) {
 			return;
 		} else if (idx < Z_L(0) ||
-			par.productions.size() - par.results.production_size(par.sm, par.results.entry.param) + static_cast<size_t>(idx) >= par.productions.size()) {
+			par.productions.size() - par.results.production_size(par.sm(), par.results.entry.param) + static_cast<size_t>(idx) >= par.productions.size()) {
 			zend_throw_exception_ex(ParleParserException_ce, 0, "Invalid index " ZEND_LONG_FMT, idx);
 			return;
 		}
 
-		std::size_t id = par.sm._rules.
+		std::size_t id = par.sm()._rules.
 			at(par.results.entry.param).second[idx];
 		bool token = id < par.rules.terminals_count();
 		parle::string name;
@@ -1137,30 +2038,132 @@ _parser_sigil_name(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 			name = par.rules.name_from_nt_id(id);
 		}
 
-		r8 = PARLE_SCVT_U8(name);
-		RETURN_STRINGL(r8.c_str(), r8.size());
-	} catch (const std::exception &e) {
-		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+		r8 = PARLE_SCVT_U8(name);
+		RETURN_STRINGL(r8.c_str(), r8.size());
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+}
+/* }}} */
+
+/* {{{ public Parser\SigilName Parser::sigilName(int $idx) */
+PHP_METHOD(ParleParser, sigilName)
+{
+	_parser_sigil_name<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
+}
+/* }}} */
+
+/* {{{ public Parser\SigilName RParser::sigilName(int $idx) */
+PHP_METHOD(ParleRParser, sigilName)
+{
+	_parser_sigil_name<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
+}
+/* }}} */
+
+template <typename parser_obj_type> void
+_parser_advance(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	zval *me;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O", &me, ce) == FAILURE) {
+		return;
+	}
+
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+
+	try {
+		auto &par = *zppo->par;
+		auto &lex = *par.lex;
+		if (nullptr == par.lex) {
+			zend_throw_exception(ParleLexerException_ce, "No Lexer supplied", 0);
+			return;
+		} else if (lex.sm().empty()) {
+			zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
+			return;
+		} else if (par.sm().empty()) {
+			zend_throw_exception(ParleParserException_ce, "Parser state machine is empty", 0);
+			return;
+		}
+		/* As in validate(), a callout may replace the tables. */
+		auto tables = par.tables;
+
+		PARLE_STATS(par.stats.step(par.results));
+		parsertl::lookup(lex.iter, tables->sm, par.results, par.productions);
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public void Parser::advance(void) */
+PHP_METHOD(ParleParser, advance)
+{
+	_parser_advance<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
+}
+/* }}} */
+
+/* {{{ public void RParser::advance(void) */
+PHP_METHOD(ParleRParser, advance)
+{
+	_parser_advance<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
+}
+/* }}} */
+
+template <typename parser_obj_type> void
+_parser_stats(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	zval *me;
+	zend_bool reset = 0;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O|b", &me, ce, &reset) == FAILURE) {
+		return;
+	}
+
+#ifdef HAVE_PARLE_STATS
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+
+	auto &stats = zppo->par->stats;
+	zval reduces;
+
+	array_init(return_value);
+	add_assoc_long_ex(return_value, "shifts", sizeof("shifts") - 1, static_cast<zend_long>(stats.shifts));
+	array_init(&reduces);
+	for (size_t i = 0; i < stats.reduces.size(); i++) {
+		if (stats.reduces[i]) {
+			add_index_long(&reduces, static_cast<zend_ulong>(i), static_cast<zend_long>(stats.reduces[i]));
+		}
+	}
+	add_assoc_zval_ex(return_value, "reduces", sizeof("reduces") - 1, &reduces);
+	add_assoc_long_ex(return_value, "gotos", sizeof("gotos") - 1, static_cast<zend_long>(stats.gotos));
+	add_assoc_long_ex(return_value, "max_depth", sizeof("max_depth") - 1, static_cast<zend_long>(stats.max_depth));
+	php_parle_stats_phases(return_value, stats.build);
+
+	if (reset) {
+		stats.reset();
 	}
-}
-/* }}} */
+#else
+	(void)zppo;
+	RETURN_NULL();
+#endif
+}/*}}}*/
 
-/* {{{ public Parser\SigilName Parser::sigilName(int $idx) */
-PHP_METHOD(ParleParser, sigilName)
+/* {{{ public ?array Parser::stats([bool $reset = false]) */
+PHP_METHOD(ParleParser, stats)
 {
-	_parser_sigil_name<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
+	_parser_stats<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
 }
 /* }}} */
 
-/* {{{ public Parser\SigilName RParser::sigilName(int $idx) */
-PHP_METHOD(ParleRParser, sigilName)
+/* {{{ public ?array RParser::stats([bool $reset = false]) */
+PHP_METHOD(ParleRParser, stats)
 {
-	_parser_sigil_name<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
+	_parser_stats<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
 }
 /* }}} */
 
 template <typename parser_obj_type> void
-_parser_advance(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+_parser_memory_usage(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
 	parser_obj_type *zppo;
 	zval *me;
@@ -1171,36 +2174,38 @@ _parser_advance(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
 
+	auto &par = *zppo->par;
+
 	try {
-		auto &par = *zppo->par;
-		auto &lex = *par.lex;
-		if (nullptr == par.lex) {
-			zend_throw_exception(ParleLexerException_ce, "No Lexer supplied", 0);
-			return;
-		} else if (lex.sm.empty()) {
-			zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
-			return;
-		} else if (par.sm.empty()) {
-			zend_throw_exception(ParleParserException_ce, "Parser state machine is empty", 0);
-			return;
+		using parle::memory::heap;
+		size_t checkpoints = par.checkpoints.capacity() * sizeof(typename decltype(par.checkpoints)::value_type);
+
+		for (auto &cp : par.checkpoints) {
+			checkpoints += heap(cp.results.stack) + heap(cp.productions);
 		}
-		parsertl::lookup(lex.iter, par.sm, par.results, par.productions);
+
+		php_parle_memory_usage(return_value, {
+			{"rules", parle::memory::parser_rules(par.rules) + heap(par.defs)},
+			{"table", parle::memory::parser_table(par.sm())},
+			{"productions", heap(par.productions) + heap(par.results.stack)},
+			{"checkpoints", checkpoints},
+		});
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
 	}
 }/*}}}*/
 
-/* {{{ public void Parser::advance(void) */
-PHP_METHOD(ParleParser, advance)
+/* {{{ public array Parser::memoryUsage(void) */
+PHP_METHOD(ParleParser, memoryUsage)
 {
-	_parser_advance<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
+	_parser_memory_usage<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
 }
 /* }}} */
 
-/* {{{ public void RParser::advance(void) */
-PHP_METHOD(ParleRParser, advance)
+/* {{{ public array RParser::memoryUsage(void) */
+PHP_METHOD(ParleRParser, memoryUsage)
 {
-	_parser_advance<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
+	_parser_memory_usage<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
 }
 /* }}} */
 
@@ -1223,18 +2228,22 @@ _parser_consume(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *par_ce, zend_cla
 		auto &par = *zppo->par;
 		par.lex = zplo->lex;
 		auto &lex = *par.lex;
-		if (lex.sm.empty()) {
+		if (lex.sm().empty()) {
 			zend_throw_exception(ParleLexerException_ce, "Lexer state machine is empty", 0);
 			return;
-		} else if (par.sm.empty()) {
+		} else if (par.sm().empty()) {
 			zend_throw_exception(ParleParserException_ce, "Parser state machine is empty", 0);
 			return;
 		}
 		lex.in = PARLE_CVT_U32(ZSTR_VAL(in));
+		lex.generation++;
 		lex.iter = {lex.in.begin(), lex.in.end(), lex, true};
+		lex.checkpoints.clear();
 		lex.par = zppo->par;
-		par.productions = {};
-		par.results = {lex.iter->id, par.sm};
+		/* Same as in _parser_validate(). */
+		par.productions.clear();
+		par.results.reset(lex.iter->id, par.sm());
+		par.checkpoints.clear();
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
 	}
@@ -1285,7 +2294,7 @@ _parser_dump(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 		std::stringstream ss;
 		std::string str;
 
-		parsertl::debug::dump(par.rules, ss);
+		parle::parser::debug::dump(par.rules, ss);
 		str = ss.str();
 		php_write((void*)str.c_str(), str.size());
 #endif
@@ -1347,7 +2356,7 @@ _parser_trace(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 				std::vector<parle::string> symbols;
 				par.rules.terminals(symbols);
 				par.rules.non_terminals(symbols);
-				parle::parser::state_machine::id_type_vector_pair &pair_ = par.sm._rules[entry.param];
+				const parle::parser::state_machine::id_type_vector_pair &pair_ = par.sm()._rules[entry.param];
 
 				s = PARLE_PRE_U32("reduce by ") + symbols[pair_.first] + PARLE_PRE_U32(" ->");
 
@@ -1424,6 +2433,18 @@ _parser_errorinfo(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 		add_property_stringl_ex(&token, "value", sizeof("value")-1, (char *)ret.c_str(), ret.size());
 #endif
 		add_property_zval_ex(return_value, "token", sizeof("token")-1, &token);
+		zval_ptr_dtor(&token);
+
+		/* Callouts aren't run again for this. */
+		using results = typename decltype(lex.iter)::value_type;
+		zval expected;
+		array_init(&expected);
+		for (auto id : parle::parser::expected<results>(lex.sm(), lex.keywords(), par.sm(), lex.in.cbegin(), lex.in.cend(), par.rules.terminals_count())) {
+			std::string name = PARLE_SCVT_U8(par.rules.name_from_token_id(id));
+			add_next_index_stringl(&expected, name.c_str(), name.size());
+		}
+		add_property_zval_ex(return_value, "expected", sizeof("expected")-1, &expected);
+		zval_ptr_dtor(&expected);
 		/* TODO provide details also for other error types, if possible. */
 	} catch (const std::exception &e) {
 		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
@@ -1458,7 +2479,7 @@ _parser_reset(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
 	auto &par = *zppo->par;
 
-	par.results.reset(static_cast<parle::id_type>(tid), par.sm);
+	par.results.reset(static_cast<parle::id_type>(tid), par.sm());
 }
 /* }}} */
 
@@ -1480,7 +2501,7 @@ _parser_sigil_count(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try
 	{
-		RETURN_LONG(par.results.production_size(par.sm,
+		RETURN_LONG(par.results.production_size(par.sm(),
 			par.results.entry.param));
 	}
 	catch (const std::exception &e)
@@ -1520,6 +2541,182 @@ PHP_METHOD(ParleRParser, sigilCount)
 }
 /* }}} */
 
+/* A checkpoint belongs to the input it was taken on. Lexer::consume(),
+	Parser::consume() and validate() replace that input, even with the
+	same string, and restore() throws for checkpoints taken before. So a
+	parse can't be resumed across an edit, it starts over. */
+template <typename parser_obj_type> void
+_parser_checkpoint(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	zval *me;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "O", &me, ce) == FAILURE) {
+		return;
+	}
+
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+	auto &par = *zppo->par;
+
+	if (nullptr == par.lex) {
+		zend_throw_exception(ParleParserException_ce, "No lexer supplied", 0);
+		return;
+	}
+
+	try {
+		/* Proportional to the parser stack depth, the input isn't copied. */
+		par.checkpoints.push_back({par.lex->iter.checkpoint(), par.results, par.productions, par.lex->generation});
+		RETURN_LONG(static_cast<zend_long>(par.checkpoints.size() - 1));
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public int Parser::checkpoint(void) */
+PHP_METHOD(ParleParser, checkpoint)
+{
+	_parser_checkpoint<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
+}
+/* }}} */
+
+/* {{{ public int RParser::checkpoint(void) */
+PHP_METHOD(ParleRParser, checkpoint)
+{
+	_parser_checkpoint<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
+}
+/* }}} */
+
+template <typename parser_obj_type> void
+_parser_restore(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	zval *me;
+	zend_long id;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "Ol", &me, ce, &id) == FAILURE) {
+		return;
+	}
+
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+	auto &par = *zppo->par;
+
+	if (nullptr == par.lex) {
+		zend_throw_exception(ParleParserException_ce, "No lexer supplied", 0);
+		return;
+	} else if (id < 0 || static_cast<size_t>(id) >= par.checkpoints.size()) {
+		zend_throw_exception_ex(ParleParserException_ce, 0, "Invalid checkpoint " ZEND_LONG_FMT, id);
+		return;
+	} else if (par.checkpoints[static_cast<size_t>(id)].generation != par.lex->generation) {
+		/* The lexer input was replaced since, f.e. by Lexer::consume()
+			or by another parser sharing the lexer. */
+		zend_throw_exception_ex(ParleParserException_ce, 0, "Stale checkpoint " ZEND_LONG_FMT ", the lexer input was replaced", id);
+		return;
+	}
+
+	try {
+		par.checkpoints.resize(static_cast<size_t>(id) + 1);
+		auto &cp = par.checkpoints.back();
+		par.lex->iter.restore(cp.lex);
+		par.results = cp.results;
+		par.productions = cp.productions;
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+}/*}}}*/
+
+/* {{{ public void Parser::restore(int $id) */
+PHP_METHOD(ParleParser, restore)
+{
+	_parser_restore<ze_parle_parser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce);
+}
+/* }}} */
+
+/* {{{ public void RParser::restore(int $id) */
+PHP_METHOD(ParleRParser, restore)
+{
+	_parser_restore<ze_parle_rparser_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce);
+}
+/* }}} */
+
+template <typename parser_obj_type, typename lexer_obj_type> void
+_parser_clone(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *par_ce, zend_class_entry *lex_ce) noexcept
+{/*{{{*/
+	parser_obj_type *zppo;
+	lexer_obj_type *zplo;
+	zval *me, *zlex;
+
+	if(zend_parse_method_parameters(ZEND_NUM_ARGS(), getThis(), "OO", &me, par_ce, &zlex, lex_ce) == FAILURE) {
+		return;
+	}
+
+	zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(Z_OBJ_P(me));
+	zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(Z_OBJ_P(zlex));
+
+	const auto *old_lex = zppo->par->lex;
+	auto &lex = *zplo->lex;
+
+	if (nullptr == old_lex) {
+		zend_throw_exception(ParleParserException_ce, "No lexer supplied", 0);
+		return;
+	} else if (&lex == old_lex || lex.generation != old_lex->generation || lex.tables != old_lex->tables || lex.in != old_lex->in ||
+		lex.iter->first - lex.in.cbegin() != old_lex->iter->first - old_lex->in.cbegin()) {
+		/* Anything else than a clone of the lexer, taken at the position
+			the parser is at, would leave the clone with a lookahead that
+			doesn't match the input. */
+		zend_throw_exception(ParleParserException_ce, "Lexer is not a clone at the position of the parser's lexer", 0);
+		return;
+	}
+
+#if PHP_VERSION_ID < 80000
+	zend_object *obj = Z_OBJ_HT_P(me)->clone_obj(me);
+#else
+	zend_object *obj = Z_OBJ_HT_P(me)->clone_obj(Z_OBJ_P(me));
+#endif
+	RETVAL_OBJ(obj);
+	if (EG(exception)) {
+		return;
+	}
+
+	auto &par = *_php_parle_parser_fetch_zobj<parser_obj_type>(obj)->par;
+	const auto from = old_lex->in.cbegin(), to = lex.in.cbegin();
+	auto rebase = [&from, &to](decltype(par.productions) &productions) {
+		for (auto &tok : productions) {
+			tok.first = to + (tok.first - from);
+			tok.second = to + (tok.second - from);
+		}
+	};
+
+	/* The productions and checkpoints point into the input of the old
+		lexer, move them over to the copy the clone consumes from. */
+	par.lex = zplo->lex;
+	lex.par = &par;
+	rebase(par.productions);
+	for (auto &cp : par.checkpoints) {
+		if (cp.generation != old_lex->generation) {
+			/* Points into an input gone already, stays stale. */
+			cp.generation = ~lex.generation;
+			continue;
+		}
+		decltype(lex.iter)::rebase(cp.lex.match, from, to);
+		rebase(cp.productions);
+		cp.generation = lex.generation;
+	}
+}/*}}}*/
+
+/* {{{ public Parser Parser::clone(Lexer $lexer) */
+PHP_METHOD(ParleParser, clone)
+{
+	_parser_clone<ze_parle_parser_obj, ze_parle_lexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleParser_ce, ParleLexer_ce);
+}
+/* }}} */
+
+/* {{{ public RParser RParser::clone(RLexer $lexer) */
+PHP_METHOD(ParleRParser, clone)
+{
+	_parser_clone<ze_parle_rparser_obj, ze_parle_rlexer_obj>(INTERNAL_FUNCTION_PARAM_PASSTHRU, ParleRParser_ce, ParleRLexer_ce);
+}
+/* }}} */
+
 template <typename parser_obj_type> void
 _parser_read_bison(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 {/*{{{*/
@@ -1535,9 +2732,11 @@ _parser_read_bison(INTERNAL_FUNCTION_PARAMETERS, zend_class_entry *ce) noexcept
 
 	try {
 		auto &rules = zppo->par->rules;
+		parle::cache::record(zppo->par->defs, {"readBison", ZSTR_VAL(input)});
 		parle::string bison(PARLE_CVT_U32(ZSTR_VAL(input)));
 
 		rules.clear();
+		rules.flags(*parsertl::rule_flags::enable_captures);
 		parsertl::read_bison(bison.c_str(),
 			bison.c_str() + bison.size(),
 			rules);
@@ -1627,6 +2826,10 @@ ZEND_END_ARG_INFO();
 ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_lexer_build, 0, 0, 0)
 ZEND_END_ARG_INFO();
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_lexer_build_fold, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, foldKeywords, _IS_BOOL, 0)
+ZEND_END_ARG_INFO();
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_lexer_push, 0, 0, 0)
 	ZEND_ARG_VARIADIC_INFO(0, args)
 ZEND_END_ARG_INFO();
@@ -1645,11 +2848,38 @@ ZEND_END_ARG_INFO();
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_lexer_reset, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, pos, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, state, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, bol, _IS_BOOL, 1)
 ZEND_END_ARG_INFO();
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_lexer_dump, 0, 0, 0)
 ZEND_END_ARG_INFO();
 
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_checkpoint, 0, 0, IS_LONG, 0)
+ZEND_END_ARG_INFO();
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_restore, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, id, IS_LONG, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_lexer_tokenize, 0, 0, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, threads, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, resync, IS_STRING, 1)
+	ZEND_ARG_TYPE_INFO(0, speculative, _IS_BOOL, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_lexer_replace, 0, 2, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, replacements, IS_ARRAY, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_stats, 0, 0, IS_ARRAY, 1)
+	ZEND_ARG_TYPE_INFO(0, reset, _IS_BOOL, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_memory_usage, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO();
+
 PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_lexer_pushstate, 0, 1, IS_LONG, 0)
 	ZEND_ARG_TYPE_INFO(0, state, IS_STRING, 0)
 ZEND_END_ARG_INFO();
@@ -1684,6 +2914,7 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_parser_read_bison, 0, 0, 1)
 ZEND_END_ARG_INFO();
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_parser_build, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 0)
 ZEND_END_ARG_INFO();
 
 PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_parser_push, 0, 2, IS_LONG, 0)
@@ -1701,6 +2932,38 @@ PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_rparser_validate, 0, 0, _
 	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\RLexer, 0)
 ZEND_END_ARG_INFO();
 
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_parser_validatemany, 0, 2, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, data, IS_ARRAY, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\Lexer, 0)
+	ZEND_ARG_TYPE_INFO(0, threads, IS_LONG, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_rparser_validatemany, 0, 2, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, data, IS_ARRAY, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\RLexer, 0)
+	ZEND_ARG_TYPE_INFO(0, threads, IS_LONG, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_parser_search, 0, 2, IS_ARRAY, 1)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\Lexer, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_parser_searchall, 0, 2, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\Lexer, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_rparser_search, 0, 2, IS_ARRAY, 1)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\RLexer, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_rparser_searchall, 0, 2, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\RLexer, 0)
+ZEND_END_ARG_INFO();
+
 PARLE_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_parle_parser_tokenid, 0, 1, IS_LONG, 0)
 	ZEND_ARG_TYPE_INFO(0, tok, IS_STRING, 0)
 ZEND_END_ARG_INFO();
@@ -1726,6 +2989,14 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_rparser_consume, 0, 0, 2)
 	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\RLexer, 0)
 ZEND_END_ARG_INFO();
 
+PARLE_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_parle_parser_clone, 0, 1, Parle\\Parser, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\Lexer, 0)
+ZEND_END_ARG_INFO();
+
+PARLE_BEGIN_ARG_WITH_RETURN_OBJ_INFO_EX(arginfo_parle_rparser_clone, 0, 1, Parle\\RParser, 0)
+	ZEND_ARG_OBJ_INFO(0, lexer, Parle\\RLexer, 0)
+ZEND_END_ARG_INFO();
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_parle_parser_reset, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, tok, IS_LONG, 0)
 ZEND_END_ARG_INFO();
@@ -1775,13 +3046,19 @@ const zend_function_entry ParleToken_methods[] = {
 const zend_function_entry ParleLexer_methods[] = {
 	PHP_ME(ParleLexer, push, arginfo_parle_lexer_push, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, getToken, arginfo_parle_lexer_gettoken, ZEND_ACC_PUBLIC)
-	PHP_ME(ParleLexer, build, arginfo_parle_lexer_build, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, build, arginfo_parle_lexer_build_fold, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, consume, arginfo_parle_lexer_consume, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, advance, arginfo_parle_lexer_advance, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, reset, arginfo_parle_lexer_reset, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, insertMacro, arginfo_parle_lexer_insertmacro, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, dump, arginfo_parle_lexer_dump, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleLexer, callout, arginfo_parle_lexer_callout, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, checkpoint, arginfo_parle_checkpoint, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, restore, arginfo_parle_restore, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, tokenize, arginfo_parle_lexer_tokenize, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, replace, arginfo_parle_lexer_replace, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, stats, arginfo_parle_stats, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleLexer, memoryUsage, arginfo_parle_memory_usage, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -1796,6 +3073,12 @@ const zend_function_entry ParleRLexer_methods[] = {
 	PHP_ME(ParleRLexer, insertMacro, arginfo_parle_lexer_insertmacro, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRLexer, dump, arginfo_parle_lexer_dump, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRLexer, callout, arginfo_parle_lexer_callout, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRLexer, checkpoint, arginfo_parle_checkpoint, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRLexer, restore, arginfo_parle_restore, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRLexer, tokenize, arginfo_parle_lexer_tokenize, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRLexer, replace, arginfo_parle_lexer_replace, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRLexer, stats, arginfo_parle_stats, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRLexer, memoryUsage, arginfo_parle_memory_usage, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -1808,6 +3091,9 @@ const zend_function_entry ParleParser_methods[] = {
 	PHP_ME(ParleParser, build, arginfo_parle_parser_build, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, push, arginfo_parle_parser_push, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, validate, arginfo_parle_parser_validate, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, validateMany, arginfo_parle_parser_validatemany, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, search, arginfo_parle_parser_search, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, searchAll, arginfo_parle_parser_searchall, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, tokenId, arginfo_parle_parser_tokenid, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, sigil, arginfo_parle_parser_sigil, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, sigilName, arginfo_parle_parser_sigil_name, ZEND_ACC_PUBLIC)
@@ -1819,6 +3105,11 @@ const zend_function_entry ParleParser_methods[] = {
 	PHP_ME(ParleParser, reset, arginfo_parle_parser_reset, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, sigilCount, arginfo_parle_parser_sigil_count, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleParser, readBison, arginfo_parle_parser_read_bison, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, checkpoint, arginfo_parle_checkpoint, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, restore, arginfo_parle_restore, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, stats, arginfo_parle_stats, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, memoryUsage, arginfo_parle_memory_usage, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleParser, clone, arginfo_parle_parser_clone, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -1831,6 +3122,9 @@ const zend_function_entry ParleRParser_methods[] = {
 	PHP_ME(ParleRParser, build, arginfo_parle_parser_build, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, push, arginfo_parle_parser_push, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, validate, arginfo_parle_rparser_validate, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, validateMany, arginfo_parle_rparser_validatemany, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, search, arginfo_parle_rparser_search, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, searchAll, arginfo_parle_rparser_searchall, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, tokenId, arginfo_parle_parser_tokenid, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, sigil, arginfo_parle_parser_sigil, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, sigilName, arginfo_parle_parser_sigil_name, ZEND_ACC_PUBLIC)
@@ -1842,6 +3136,11 @@ const zend_function_entry ParleRParser_methods[] = {
 	PHP_ME(ParleRParser, reset, arginfo_parle_parser_reset, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, sigilCount, arginfo_parle_parser_sigil_count, ZEND_ACC_PUBLIC)
 	PHP_ME(ParleRParser, readBison, arginfo_parle_parser_read_bison, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, checkpoint, arginfo_parle_checkpoint, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, restore, arginfo_parle_restore, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, stats, arginfo_parle_stats, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, memoryUsage, arginfo_parle_memory_usage, ZEND_ACC_PUBLIC)
+	PHP_ME(ParleRParser, clone, arginfo_parle_rparser_clone, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -1943,6 +3242,71 @@ php_parle_lexer_object_init(zend_class_entry *ce) noexcept
 	return php_parle_lexer_obj_ctor<ze_parle_lexer_obj>(ce, &parle_lexer_handlers);
 }/*}}}*/
 
+/* The clone shares the built tables and gets a copy of everything else,
+	so it lexes on from the same position independently. It isn't attached
+	to the parser the original may be used by. */
+template<typename lexer_obj_type> zend_object *
+php_parle_lexer_obj_clone(zend_object *old_obj, zend_object_handlers *obj_handlers) noexcept
+{/*{{{*/
+	zend_object *new_obj = php_parle_lexer_obj_ctor<lexer_obj_type>(old_obj->ce, obj_handlers);
+	lexer_obj_type *zplo = _php_parle_lexer_fetch_zobj<lexer_obj_type>(new_obj);
+	const auto &old_lex = *_php_parle_lexer_fetch_zobj<lexer_obj_type>(old_obj)->lex;
+
+	zend_objects_clone_members(new_obj, old_obj);
+
+	try {
+		auto *copy = new std::remove_pointer_t<decltype(zplo->lex)>(old_lex);
+
+		delete zplo->lex;
+		zplo->lex = copy;
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleLexerException_ce, e.what(), 0);
+		return new_obj;
+	}
+
+	auto &lex = *zplo->lex;
+
+	for (auto &it : lex.cb_map) {
+		Z_TRY_ADDREF(it.second.cb);
+	}
+	lex.par = nullptr;
+	lex.iter = {old_lex.iter, lex, old_lex.in.cbegin(), lex.in.cbegin()};
+	/* Not taken over by the assignment. */
+	lex.iter.line = old_lex.iter.line;
+	lex.iter.column = old_lex.iter.column;
+	for (auto &cp : lex.checkpoints) {
+		decltype(lex.iter)::rebase(cp.match, old_lex.in.cbegin(), lex.in.cbegin());
+	}
+
+	return new_obj;
+}/*}}}*/
+
+static zend_object *
+#if PHP_VERSION_ID < 80000
+php_parle_lexer_clone(zval *object) noexcept
+{/*{{{*/
+	return php_parle_lexer_obj_clone<ze_parle_lexer_obj>(Z_OBJ_P(object), &parle_lexer_handlers);
+}/*}}}*/
+#else
+php_parle_lexer_clone(zend_object *object) noexcept
+{/*{{{*/
+	return php_parle_lexer_obj_clone<ze_parle_lexer_obj>(object, &parle_lexer_handlers);
+}/*}}}*/
+#endif
+
+static zend_object *
+#if PHP_VERSION_ID < 80000
+php_parle_rlexer_clone(zval *object) noexcept
+{/*{{{*/
+	return php_parle_lexer_obj_clone<ze_parle_rlexer_obj>(Z_OBJ_P(object), &parle_rlexer_handlers);
+}/*}}}*/
+#else
+php_parle_rlexer_clone(zend_object *object) noexcept
+{/*{{{*/
+	return php_parle_lexer_obj_clone<ze_parle_rlexer_obj>(object, &parle_rlexer_handlers);
+}/*}}}*/
+#endif
+
 template <typename lexer_obj_type> zval * 
 #if PHP_VERSION_ID < 80000
 php_parle_lex_read_property(zval *object, zval *member, int type, void **cache_slot, zval *rv) noexcept
@@ -2064,7 +3428,9 @@ php_parle_lex_write_property(zend_object *object, zend_string *member, zval *val
 			lex.iter.set_bol(static_cast<bool>(zval_is_true(value) == 1));
 		}
 	} else if (PARLE_IS_PROP("flags")) {
-		lex.rules.flags(zval_get_long(value));
+		zend_long flags = zval_get_long(value);
+		parle::cache::record(lex.defs, {"flags", std::to_string(flags)});
+		lex.rules.flags(flags);
 	}
 #if PHP_VERSION_ID >= 70400
 	  else PARLE_LEX_CHECK_THROW_RET_RO_PROP("state")
@@ -2361,6 +3727,55 @@ php_parle_rparser_object_init(zend_class_entry *ce) noexcept
 	return php_parle_parser_obj_ctor<ze_parle_rparser_obj>(ce, &parle_rparser_handlers);
 }/*}}}*/
 
+/* Shares the built tables with the original. The parser state is copied,
+	the clone goes on with the lexer the original consumes from. Use
+	Parser::clone() with a clone of the lexer to run both on their own. */
+template<typename parser_obj_type> zend_object *
+php_parle_parser_obj_clone(zend_object *old_obj, zend_object_handlers *obj_handlers) noexcept
+{/*{{{*/
+	zend_object *new_obj = php_parle_parser_obj_ctor<parser_obj_type>(old_obj->ce, obj_handlers);
+	parser_obj_type *zppo = _php_parle_parser_fetch_zobj<parser_obj_type>(new_obj);
+
+	zend_objects_clone_members(new_obj, old_obj);
+
+	try {
+		auto *copy = new std::remove_pointer_t<decltype(zppo->par)>(*_php_parle_parser_fetch_zobj<parser_obj_type>(old_obj)->par);
+
+		delete zppo->par;
+		zppo->par = copy;
+	} catch (const std::exception &e) {
+		php_parle_rethrow_from_cpp(ParleParserException_ce, e.what(), 0);
+	}
+
+	return new_obj;
+}/*}}}*/
+
+static zend_object *
+#if PHP_VERSION_ID < 80000
+php_parle_parser_clone(zval *object) noexcept
+{/*{{{*/
+	return php_parle_parser_obj_clone<ze_parle_parser_obj>(Z_OBJ_P(object), &parle_parser_handlers);
+}/*}}}*/
+#else
+php_parle_parser_clone(zend_object *object) noexcept
+{/*{{{*/
+	return php_parle_parser_obj_clone<ze_parle_parser_obj>(object, &parle_parser_handlers);
+}/*}}}*/
+#endif
+
+static zend_object *
+#if PHP_VERSION_ID < 80000
+php_parle_rparser_clone(zval *object) noexcept
+{/*{{{*/
+	return php_parle_parser_obj_clone<ze_parle_rparser_obj>(Z_OBJ_P(object), &parle_rparser_handlers);
+}/*}}}*/
+#else
+php_parle_rparser_clone(zend_object *object) noexcept
+{/*{{{*/
+	return php_parle_parser_obj_clone<ze_parle_rparser_obj>(object, &parle_rparser_handlers);
+}/*}}}*/
+#endif
+
 template<typename parser_obj_type> static zval * 
 #if PHP_VERSION_ID < 80000
 php_parle_par_read_property(zval *object, zval *member, int type, void **cache_slot, zval *rv) noexcept
@@ -2973,23 +4388,17 @@ php_parle_stack_get_property_ptr_ptr(zend_object *object, zend_string *member, i
 
 /* {{{ PHP_INI
  */
-/* Remove comments and fill if you need to have entries in php.ini
 PHP_INI_BEGIN()
-    STD_PHP_INI_ENTRY("parle.global_value",      "42", PHP_INI_ALL, OnUpdateLong, global_value, zend_parle_globals, parle_globals)
-    STD_PHP_INI_ENTRY("parle.global_string", "foobar", PHP_INI_ALL, OnUpdateString, global_string, zend_parle_globals, parle_globals)
+	STD_PHP_INI_ENTRY("parle.cache_dir", "", PHP_INI_ALL, OnUpdateString, cache_dir, zend_parle_globals, parle_globals)
 PHP_INI_END()
-*/
 /* }}} */
 
 /* {{{ php_parle_init_globals
  */
-/* Uncomment this function if you have INI entries
 static void php_parle_init_globals(zend_parle_globals *parle_globals)
 {
-	parle_globals->global_value = 0;
-	parle_globals->global_string = NULL;
+	parle_globals->cache_dir = NULL;
 }
-*/
 /* }}} */
 
 /* {{{ PHP_MINIT_FUNCTION
@@ -2998,15 +4407,15 @@ PHP_MINIT_FUNCTION(parle)
 {
 	zend_class_entry ce;
 
-	/* If you have INI entries, uncomment these lines
+	ZEND_INIT_MODULE_GLOBALS(parle, php_parle_init_globals, NULL);
 	REGISTER_INI_ENTRIES();
-	*/
 
 	INIT_CLASS_ENTRY(ce, "Parle\\ErrorInfo", ParleErrorInfo_methods);
 	ParleErrorInfo_ce = zend_register_internal_class(&ce);
 	zend_declare_property_long(ParleErrorInfo_ce, "id", sizeof("id")-1, Z_L(0), ZEND_ACC_PUBLIC);
 	zend_declare_property_long(ParleErrorInfo_ce, "position", sizeof("position")-1, Z_L(0), ZEND_ACC_PUBLIC);
 	zend_declare_property_null(ParleErrorInfo_ce, "token", sizeof("token")-1, ZEND_ACC_PUBLIC);
+	zend_declare_property_null(ParleErrorInfo_ce, "expected", sizeof("expected")-1, ZEND_ACC_PUBLIC);
 
 	INIT_CLASS_ENTRY(ce, "Parle\\Token", ParleToken_methods);
 	ParleToken_ce = zend_register_internal_class(&ce);
@@ -3041,7 +4450,7 @@ PHP_MINIT_FUNCTION(parle)
 	};
 
 	memcpy(&parle_lexer_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
-	parle_lexer_handlers.clone_obj = NULL;
+	parle_lexer_handlers.clone_obj = php_parle_lexer_clone;
 	parle_lexer_handlers.offset = XtOffsetOf(ze_parle_lexer_obj, zo);
 	parle_lexer_handlers.free_obj = php_parle_lexer_obj_destroy;
 	parle_lexer_handlers.read_property = php_parle_lexer_read_property;
@@ -3056,7 +4465,7 @@ PHP_MINIT_FUNCTION(parle)
 	init_lexer_consts_and_props(ParleLexer_ce);
 
 	memcpy(&parle_rlexer_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
-	parle_rlexer_handlers.clone_obj = NULL;
+	parle_rlexer_handlers.clone_obj = php_parle_rlexer_clone;
 	parle_rlexer_handlers.offset = XtOffsetOf(ze_parle_rlexer_obj, zo);
 	parle_rlexer_handlers.free_obj = php_parle_rlexer_obj_destroy;
 	parle_rlexer_handlers.read_property = php_parle_rlexer_read_property;
@@ -3080,6 +4489,9 @@ PHP_MINIT_FUNCTION(parle)
 		DECL_CONST("ERROR_SYNTAX", (zend_long)parsertl::error_type::syntax_error)
 		DECL_CONST("ERROR_NON_ASSOCIATIVE", (zend_long)parsertl::error_type::non_associative)
 		DECL_CONST("ERROR_UNKNOWN_TOKEN", (zend_long)parsertl::error_type::unknown_token)
+		DECL_CONST("DEFAULT_REDUCTIONS", (zend_long)parle::parser::default_reductions)
+		DECL_CONST("ELIMINATE_UNIT_RULES", (zend_long)parle::parser::eliminate_unit_rules)
+		DECL_CONST("COMPRESS_TABLE", (zend_long)parle::parser::compress_table)
 #undef DECL_CONST
 		zend_declare_property_long(ce, "action", sizeof("action")-1, 0, ZEND_ACC_PUBLIC);
 		zend_declare_property_long(ce, "reduceId", sizeof("reduceId")-1, 0, ZEND_ACC_PUBLIC);
@@ -3092,7 +4504,7 @@ PHP_MINIT_FUNCTION(parle)
 	};
 
 	memcpy(&parle_parser_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
-	parle_parser_handlers.clone_obj = NULL;
+	parle_parser_handlers.clone_obj = php_parle_parser_clone;
 	parle_parser_handlers.offset = XtOffsetOf(ze_parle_parser_obj, zo);
 	parle_parser_handlers.free_obj = php_parle_parser_obj_destroy;
 	parle_parser_handlers.read_property = php_parle_parser_read_property;
@@ -3107,7 +4519,7 @@ PHP_MINIT_FUNCTION(parle)
 	init_parser_consts_and_props(ParleParser_ce);
 
 	memcpy(&parle_rparser_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
-	parle_rparser_handlers.clone_obj = NULL;
+	parle_rparser_handlers.clone_obj = php_parle_rparser_clone;
 	parle_rparser_handlers.offset = XtOffsetOf(ze_parle_rparser_obj, zo);
 	parle_rparser_handlers.free_obj = php_parle_rparser_obj_destroy;
 	parle_rparser_handlers.read_property = php_parle_rparser_read_property;
@@ -3152,6 +4564,7 @@ PHP_MINIT_FUNCTION(parle)
 	ParleStackException_ce = zend_register_internal_class_ex(&ce, zend_exception_get_default());
 
 	REGISTER_NS_BOOL_CONSTANT("Parle", "INTERNAL_UTF32", PARLE_U32, CONST_PERSISTENT | CONST_CS);
+	REGISTER_NS_BOOL_CONSTANT("Parle", "STATS", PARLE_STATS_ON, CONST_PERSISTENT | CONST_CS);
 
 	return SUCCESS;
 }
@@ -3161,9 +4574,7 @@ PHP_MINIT_FUNCTION(parle)
  */
 PHP_MSHUTDOWN_FUNCTION(parle)
 {
-	/* uncomment this line if you have INI entries
 	UNREGISTER_INI_ENTRIES();
-	*/
 	return SUCCESS;
 }
 /* }}} */
@@ -3176,11 +4587,10 @@ PHP_MINFO_FUNCTION(parle)
 	php_info_print_table_header(2, "Lexing and parsing support", "enabled");
 	php_info_print_table_row(2, "Parle version", PHP_PARLE_VERSION);
 	php_info_print_table_row(2, "Parle internal UTF-32", (PARLE_U32 ? "yes" : "no"));
+	php_info_print_table_row(2, "Parle profiling counters", (PARLE_STATS_ON ? "yes" : "no"));
 	php_info_print_table_end();
 
-	/* Remove comments if you have entries in php.ini
 	DISPLAY_INI_ENTRIES();
-	*/
 }
 /* }}} */
 
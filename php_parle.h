@@ -49,15 +49,11 @@ extern zend_module_entry parle_module_entry;
 #include "TSRM.h"
 #endif
 
-/*
-  	Declare any global variables you may need between the BEGIN
-	and END macros here:
-
 ZEND_BEGIN_MODULE_GLOBALS(parle)
-	zend_long  global_value;
-	char *global_string;
+	char *cache_dir;
 ZEND_END_MODULE_GLOBALS(parle)
-*/
+
+ZEND_EXTERN_MODULE_GLOBALS(parle)
 
 /* Always refer to the globals in your function as PARLE_G(variable).
    You are encouraged to rename these macros something shorter, see
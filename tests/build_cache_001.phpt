@@ -0,0 +1,98 @@
+--TEST--
+Build cache in parle.cache_dir
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Parser, Token};
+
+$dir = sys_get_temp_dir() . DIRECTORY_SEPARATOR . "parle_cache_" . getmypid();
+@mkdir($dir);
+ini_set("parle.cache_dir", $dir);
+
+function lex_all($in, $fold)
+{
+	$ret = [];
+	$lex = new Lexer;
+	$lex->push("if", 1);
+	$lex->push("[a-z]+", 2);
+	$lex->push("\\d+", 3);
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build($fold);
+	$lex->consume($in);
+	$lex->advance();
+	while (Token::EOI != $lex->getToken()->id) {
+		$ret[] = $lex->getToken()->id . ":" . $lex->getToken()->value;
+		$lex->advance();
+	}
+	return implode(" ", $ret);
+}
+
+function parse_all($in)
+{
+	$p = new Parser;
+	$p->token("NUM");
+	$p->left("'+'");
+	$p->push("start", "exp");
+	$p->push("exp", "exp '+' exp");
+	$p->push("exp", "NUM");
+	$p->build();
+
+	$lex = new Lexer;
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	$lex->push("\\+", $p->tokenId("'+'"));
+	$lex->build();
+
+	return $p->validate($in, $lex);
+}
+
+var_dump(lex_all("if x 42", false));
+var_dump(lex_all("if x 42", true));
+var_dump(parse_all("1+2+3"));
+var_dump(count(glob($dir . DIRECTORY_SEPARATOR . "parle-*.bin")));
+
+/* Now from the cache. */
+var_dump(lex_all("if x 42", false));
+var_dump(lex_all("if x 42", true));
+var_dump(parse_all("1+2+3"), parse_all("1+"));
+var_dump(count(glob($dir . DIRECTORY_SEPARATOR . "parle-*.bin")));
+
+/* A damaged entry is rebuilt. */
+foreach (glob($dir . DIRECTORY_SEPARATOR . "parle-*.bin") as $f) {
+	file_put_contents($f, "garbage");
+}
+var_dump(lex_all("if x 42", false));
+var_dump(parse_all("1+2+3"));
+
+/* So is one damaged behind an intact header. */
+foreach (glob($dir . DIRECTORY_SEPARATOR . "parle-*.bin") as $f) {
+	$data = file_get_contents($f);
+	$data[strlen($data) - 1] = chr(ord($data[strlen($data) - 1]) ^ 0xff);
+	file_put_contents($f, $data);
+}
+var_dump(lex_all("if x 42", false));
+var_dump(parse_all("1+2+3"));
+
+foreach (glob($dir . DIRECTORY_SEPARATOR . "*") as $f) {
+	unlink($f);
+}
+rmdir($dir);
+
+?>
+==DONE==
+--EXPECT--
+string(12) "1:if 2:x 3:42"
+string(12) "1:if 2:x 3:42"
+bool(true)
+int(4)
+string(12) "1:if 2:x 3:42"
+string(12) "1:if 2:x 3:42"
+bool(true)
+bool(false)
+int(4)
+string(12) "1:if 2:x 3:42"
+bool(true)
+string(12) "1:if 2:x 3:42"
+bool(true)
+==DONE==
@@ -0,0 +1,56 @@
+--TEST--
+Tables replaced by a build
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, ParserException, Lexer, Token};
+
+/* Input consumed before the build, rebuilt while lexing. */
+$lex = new Lexer;
+$lex->push("a", 1);
+$lex->consume("aab");
+$lex->build();
+$lex->advance();
+echo $lex->getToken()->id, "\n";
+$lex->push("b", 2);
+$lex->build();
+do {
+	$lex->advance();
+	echo $lex->getToken()->id, "\n";
+} while (Token::EOI != $lex->getToken()->id);
+
+/* A failed build keeps the tables of the last one. */
+$p = new Parser;
+$p->token("NUM");
+$p->push("start", "exp");
+$p->push("exp", "exp '+' NUM");
+$p->push("exp", "NUM");
+$p->build();
+
+$lex = new Lexer;
+$lex->push("\\d+", $p->tokenId("NUM"));
+$lex->push("\\+", $p->tokenId("'+'"));
+$lex->build();
+
+$p->push("exp", "exp '+' exp");
+try {
+	$p->build();
+} catch (ParserException $e) {
+	echo get_class($e), "\n";
+}
+var_dump($p->validate("1+2+3", $lex));
+var_dump($p->validate("1+", $lex));
+
+?>
+==DONE==
+--EXPECT--
+1
+1
+2
+0
+Parle\ParserException
+bool(true)
+bool(false)
+==DONE==
@@ -0,0 +1,112 @@
+--TEST--
+Clone lexers and parsers
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Lexer, RLexer, Token};
+
+function rest($lex)
+{
+	$ids = [];
+	do {
+		$lex->advance();
+		$tok = $lex->getToken();
+		$ids[] = $tok->id . ":" . $tok->value;
+	} while (Token::EOI != $tok->id);
+	echo implode(" ", $ids), "\n";
+}
+
+foreach ([Lexer::class, RLexer::class] as $class) {
+	$lex = new $class;
+	$lex->push("[a-z]+", 1);
+	$lex->push("\\d+", 2);
+	$lex->push("\\s+", Token::SKIP);
+	$words = 0;
+	$lex->callout(1, function () use (&$words) {
+		$words++;
+	});
+	$lex->build();
+
+	$lex->consume("abc 12\nde 3 f");
+	$lex->advance();
+	$lex->advance();
+	$lex->advance();
+
+	$copy = clone $lex;
+	var_dump($copy->line === $lex->line, $copy->column === $lex->column);
+	unset($lex);
+	rest($copy);
+	var_dump($words);
+
+	/* The clone has its own rules and input. */
+	$other = clone $copy;
+	$other->push(",", 3);
+	$other->build();
+	$other->consume("a,1");
+	rest($other);
+	$copy->consume("x 1");
+	rest($copy);
+}
+
+$p = new Parser;
+$p->token("NUM");
+$p->left("'+'");
+$p->push("start", "exp");
+$p->push("exp", "exp '+' exp");
+$p->push("exp", "NUM");
+$p->build();
+
+$lex = new Lexer;
+$lex->push("\\d+", $p->tokenId("NUM"));
+$lex->push("\\+", $p->tokenId("'+'"));
+$lex->build();
+
+$q = clone $p;
+var_dump($q->tokenId("NUM") == $p->tokenId("NUM"));
+var_dump($q->validate("1+2", $lex), $q->validate("1+", $lex));
+
+/* Rules added to the clone stay with the clone. */
+$q->push("exp", "'(' exp ')'");
+$q->build();
+$lex2 = clone $lex;
+$lex2->push("\\(", $q->tokenId("'('"));
+$lex2->push("\\)", $q->tokenId("')'"));
+$lex2->build();
+var_dump($q->validate("(1+2)", $lex2));
+var_dump($p->validate("1+2", $lex));
+
+/* Mid parse, the clone goes on with the same lexer. */
+$p->consume("1+2+3", $lex);
+$p->advance();
+$q = clone $p;
+var_dump($q->action == $p->action);
+while (Parser::ACTION_ACCEPT != $q->action && Parser::ACTION_ERROR != $q->action) {
+	$q->advance();
+}
+var_dump(Parser::ACTION_ACCEPT == $q->action);
+
+?>
+==DONE==
+--EXPECT--
+bool(true)
+bool(true)
+2:3 1:f 0:
+int(3)
+1:a 3:, 2:1 0:
+1:x 2:1 0:
+bool(true)
+bool(true)
+2:3 1:f 0:
+int(3)
+1:a 3:, 2:1 0:
+1:x 2:1 0:
+bool(true)
+bool(true)
+bool(false)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+==DONE==
@@ -0,0 +1,89 @@
+--TEST--
+Clone a parser together with its lexer
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, ParserException, Lexer, RParser, RLexer};
+
+function steps($p, $n = PHP_INT_MAX)
+{
+	$out = [];
+	while (count($out) < $n && Parser::ACTION_ACCEPT != $p->action && Parser::ACTION_ERROR != $p->action) {
+		if (Parser::ACTION_REDUCE == $p->action) {
+			$sigils = [];
+			for ($i = 0; $i < $p->sigilCount(); $i++) {
+				$sigils[] = $p->sigil($i);
+			}
+			$out[] = $p->reduceId . ":" . implode(",", $sigils);
+		}
+		$p->advance();
+	}
+	return implode(" ", $out);
+}
+
+foreach ([[Parser::class, Lexer::class], [RParser::class, RLexer::class]] as list($par_class, $lex_class)) {
+	$p = new $par_class;
+	$p->token("NUM");
+	$p->left("'+'");
+	$p->push("start", "exp");
+	$p->push("exp", "exp '+' exp");
+	$p->push("exp", "NUM");
+	$p->build();
+
+	$lex = new $lex_class;
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	$lex->push("\\+", $p->tokenId("'+'"));
+	$lex->build();
+
+	$p->consume("1+2+3", $lex);
+	echo steps($p, 2), "\n";
+	$cp = $p->checkpoint();
+
+	try {
+		$p->clone($lex);
+	} catch (ParserException $e) {
+		echo $e->getMessage(), "\n";
+	}
+	$ahead = clone $lex;
+	$ahead->advance();
+	try {
+		$p->clone($ahead);
+	} catch (ParserException $e) {
+		echo $e->getMessage(), "\n";
+	}
+
+	/* Each runs to the end on its own lexer. */
+	$lex2 = clone $lex;
+	$q = $p->clone($lex2);
+	echo steps($q), "\n";
+	echo steps($p), "\n";
+	var_dump(Parser::ACTION_ACCEPT == $q->action, Parser::ACTION_ACCEPT == $p->action);
+
+	/* The checkpoint went along, the original input is gone. */
+	unset($p, $lex);
+	$q->restore($cp);
+	echo steps($q), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+2:1 2:2
+Lexer is not a clone at the position of the parser's lexer
+Lexer is not a clone at the position of the parser's lexer
+1:1,+,2 2:3 1:1+2,+,3 0:1+2+3
+1:1,+,2 2:3 1:1+2,+,3 0:1+2+3
+bool(true)
+bool(true)
+1:1,+,2 2:3 1:1+2,+,3 0:1+2+3
+2:1 2:2
+Lexer is not a clone at the position of the parser's lexer
+Lexer is not a clone at the position of the parser's lexer
+1:1,+,2 2:3 1:1+2,+,3 0:1+2+3
+1:1,+,2 2:3 1:1+2,+,3 0:1+2+3
+bool(true)
+bool(true)
+1:1,+,2 2:3 1:1+2,+,3 0:1+2+3
+==DONE==
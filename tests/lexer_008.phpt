@@ -0,0 +1,33 @@
+--TEST--
+Lexer rules ending in $ next to rules without
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Token};
+
+$lex = new Lexer;
+$lex->push("[a-c]+", 1);
+$lex->push("[^\\n]+(([^\\n]\\n+\\n?|[ab])+(a\\n[^a]+)?([ab]+a?)+)+$", 2);
+$lex->build();
+
+foreach (["aaa\nca", "ab\nb", "b\nab", "ca\nba"] as $in) {
+	$lex->consume($in);
+	$toks = [];
+	do {
+		$lex->advance();
+		$tok = $lex->getToken();
+		$toks[] = (Token::UNKNOWN == $tok->id ? "?" : $tok->id) . ":" . str_replace("\n", "\\n", $tok->value);
+	} while (Token::EOI != $tok->id);
+	echo implode(" ", $toks), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+2:aaa ?:\n 1:ca 0:
+2:ab\nb 0:
+1:b ?:\n 1:ab 0:
+2:ca\nba 0:
+==DONE==
@@ -0,0 +1,45 @@
+--TEST--
+Lexer checkpoint and restore
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Token, LexerException};
+
+$lex = new Lexer;
+$lex->push("[a-z]+", 1);
+$lex->push("[ ]+", Token::SKIP);
+$lex->build();
+
+$lex->consume("one two three");
+
+$lex->advance();
+echo $lex->getToken()->value, " ", $lex->marker, "\n";
+$cp = $lex->checkpoint();
+$lex->advance();
+echo $lex->getToken()->value, " ", $lex->marker, "\n";
+$lex->advance();
+echo $lex->getToken()->value, " ", $lex->marker, "\n";
+
+$lex->restore($cp);
+echo "restored: ", $lex->getToken()->value, " ", $lex->marker, "\n";
+$lex->advance();
+echo $lex->getToken()->value, " ", $lex->marker, "\n";
+
+try {
+	$lex->restore($cp + 1);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+one 0
+two 4
+three 8
+restored: one 0
+two 4
+Invalid checkpoint 1
+==DONE==
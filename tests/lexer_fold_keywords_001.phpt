@@ -0,0 +1,59 @@
+--TEST--
+Lexer build with keywords folded
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Token};
+
+function lex_all(Lexer $lex, $in)
+{
+	$ret = [];
+	$lex->consume($in);
+	$lex->advance();
+	while (Token::EOI != $lex->getToken()->id) {
+		$ret[] = $lex->getToken()->id . ":" . $lex->getToken()->value;
+		$lex->advance();
+	}
+	return $ret;
+}
+
+function make_lexer()
+{
+	$lex = new Lexer;
+	$lex->push("if", 1);
+	$lex->push("else", 2);
+	$lex->push("\"while\"", 3);
+	$lex->push("\\<=", 4);
+	$lex->push("[a-z_][a-z_0-9]*", 10);
+	$lex->push("for", 5);
+	$lex->push("\\d+", 11);
+	$lex->push("[<>=]+", 12);
+	$lex->push("\\s+", Token::SKIP);
+	return $lex;
+}
+
+$in = "if iff else elsewhere while for 42 <= < ifelse";
+
+$plain = make_lexer();
+$plain->build();
+$folded = make_lexer();
+$folded->build(true);
+
+$seq = lex_all($plain, $in);
+var_dump($seq === lex_all($folded, $in));
+var_dump($seq === lex_all($folded, $in));
+echo implode(" ", $seq), "\n";
+
+$folded->callout(2, function () { echo "callout\n"; });
+lex_all($folded, "x else y");
+
+?>
+==DONE==
+--EXPECT--
+bool(true)
+bool(true)
+1:if 10:iff 2:else 10:elsewhere 3:while 10:for 11:42 4:<= 12:< 10:ifelse
+callout
+==DONE==
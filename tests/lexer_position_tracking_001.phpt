@@ -71,7 +71,7 @@ Match: 'a', token: 'b'
  Match: 'f', token: '
 '
  Match: 'x', token: 'y'
-object(Parle\ErrorInfo)#%d (3) {
+object(Parle\ErrorInfo)#%d (4) {
   ["id"]=>
   int(2)
   ["position"]=>
@@ -83,6 +83,15 @@ object(Parle\ErrorInfo)#%d (3) {
     ["value"]=>
     string(1) "\"
   }
+  ["expected"]=>
+  array(3) {
+    [0]=>
+    string(1) "$"
+    [1]=>
+    string(7) "NEWLINE"
+    [2]=>
+    string(6) "LETTER"
+  }
 }
 object(Parle\Lexer)#%d (7) {
   ["bol"]=>
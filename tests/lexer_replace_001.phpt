@@ -0,0 +1,48 @@
+--TEST--
+Lexer replace tokens by id
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, RLexer, Token, LexerException};
+
+foreach ([new Lexer, new RLexer] as $lex) {
+	$lex->push("[a-z]+", 1);
+	$lex->push("\\d+", 2);
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	$in = "pin 1234 and  key 99 #!x";
+	var_dump($lex->replace($in, [2 => "****"]));
+	var_dump($lex->replace($in, [1 => "w", Token::UNKNOWN => "?"]));
+	var_dump($lex->replace($in, []));
+	var_dump($lex->replace("", [1 => "w"]));
+}
+
+try {
+	$lex->replace("abc", ["x" => "y"]);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+try {
+	(new Lexer)->replace("abc", []);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+string(26) "pin **** and  key **** #!x"
+string(18) "w 1234 w  w 99 ??w"
+string(24) "pin 1234 and  key 99 #!x"
+string(0) ""
+string(26) "pin **** and  key **** #!x"
+string(18) "w 1234 w  w 99 ??w"
+string(24) "pin 1234 and  key 99 #!x"
+string(0) ""
+Replacements must be indexed by token id
+Lexer state machine is empty
+==DONE==
@@ -0,0 +1,55 @@
+--TEST--
+Restart lexing at a previous position
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Token, LexerException};
+
+$lex = new Lexer;
+$lex->push("[a-z]+", 1);
+$lex->push("[\n]", 2);
+$lex->push("[ ]", 3);
+$lex->build();
+
+$lex->consume("ab cd\nef gh");
+
+function dump_tok(Lexer $lex)
+{
+	$lex->advance();
+	$tok = $lex->getToken();
+	printf("%d %d %2d %s\n", $lex->line, $lex->column, $lex->marker, (2 == $tok->id ? ">LF<" : $tok->value));
+}
+
+do {
+	$lex->advance();
+} while (Token::EOI != $lex->getToken()->id);
+
+$lex->reset(3);
+dump_tok($lex);
+dump_tok($lex);
+dump_tok($lex);
+
+$lex->reset(6, 0);
+var_dump($lex->bol);
+dump_tok($lex);
+dump_tok($lex);
+
+try {
+	$lex->reset(0, 5);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+0 3  3 cd
+0 5  5 >LF<
+1 0  6 ef
+bool(true)
+1 0  6 ef
+1 2  8  
+Invalid state 5
+==DONE==
@@ -0,0 +1,56 @@
+--TEST--
+Restart a recursive lexer at a previous position
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{RLexer, Token, LexerException};
+
+$lex = new RLexer;
+$lex->pushState("P");
+$lex->push("INITIAL", "[a-z]+", 1, ".");
+$lex->push("*", "\\(", 2, ">P");
+$lex->push("P", "[a-z]+", 3, ".");
+$lex->push("*", "\\)", 4, "<");
+$lex->build();
+
+$lex->consume("x(ab))");
+
+function dump_rest(RLexer $lex)
+{
+	try {
+		do {
+			$lex->advance();
+			$tok = $lex->getToken();
+			echo $tok->id, ":", $tok->value, " ";
+		} while (Token::EOI != $tok->id);
+	} catch (LexerException $e) {
+		echo $e->getMessage();
+	}
+	echo "\n";
+}
+
+/* Stop inside the pushed state. */
+$lex->advance();
+$lex->advance();
+$lex->advance();
+echo $lex->getToken()->value, " ", $lex->state, "\n";
+
+/* Going back starts in INITIAL with nothing pushed, the unbalanced ')'
+	can't pop back into a state left over from the later position. */
+$lex->reset(0);
+echo $lex->state, "\n";
+dump_rest($lex);
+
+$lex->reset(2, 1);
+dump_rest($lex);
+
+?>
+==DONE==
+--EXPECT--
+ab 1
+0
+1:x 2:( 3:ab 4:) Stack underflow in lookup_state::pop()
+3:ab Stack underflow in lookup_state::pop()
+==DONE==
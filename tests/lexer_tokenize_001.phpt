@@ -0,0 +1,71 @@
+--TEST--
+Lexer tokenize on multiple threads
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Token, LexerException};
+
+$lex = new Lexer;
+$lex->push("[a-z]+", 1);
+$lex->push("\\d+", 2);
+$lex->push("^#.*", 3);
+$lex->push("\\s+", Token::SKIP);
+$lex->build();
+
+$in = "";
+for ($i = 0; $i < 40000; $i++) {
+	$in .= (0 == $i % 7) ? "#comment 42\n" : "abc 123 de\n";
+}
+
+$lex->consume($in);
+$seq = [];
+$lex->advance();
+while (Token::EOI != $lex->getToken()->id) {
+	$seq[] = [$lex->getToken()->id, $lex->marker, $lex->cursor];
+	$lex->advance();
+}
+
+var_dump($seq === $lex->tokenize());
+var_dump($seq === $lex->tokenize(4));
+var_dump($seq === $lex->tokenize(4, "^#"));
+
+$lex->consume("abc 42");
+var_dump($lex->tokenize(2));
+
+$lex->callout(1, function () {});
+try {
+	$lex->tokenize();
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+array(2) {
+  [0]=>
+  array(3) {
+    [0]=>
+    int(1)
+    [1]=>
+    int(0)
+    [2]=>
+    int(3)
+  }
+  [1]=>
+  array(3) {
+    [0]=>
+    int(2)
+    [1]=>
+    int(4)
+    [2]=>
+    int(6)
+  }
+}
+Callouts are not supported by tokenize()
+==DONE==
@@ -0,0 +1,80 @@
+--TEST--
+Lexer speculative tokenize
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{RLexer, Token, LexerException};
+
+function sequential($lex)
+{
+	$ret = [];
+	$lex->advance();
+	while (Token::EOI != $lex->getToken()->id) {
+		$ret[] = [$lex->getToken()->id, $lex->marker, $lex->cursor];
+		$lex->advance();
+	}
+	return $ret;
+}
+
+/* Parle\Lexer has no start conditions. */
+$lex = new RLexer;
+$lex->pushState("COMMENT");
+$lex->push("INITIAL", "[a-z]+", 1, ".");
+$lex->push("INITIAL", "\\d+", 2, ".");
+$lex->push("INITIAL", "\"[^\"]*\"", 3, ".");
+$lex->push("INITIAL", "\\s+", Token::SKIP, ".");
+$lex->push("INITIAL", "\\/\\*", Token::SKIP, "COMMENT");
+$lex->push("COMMENT", "\\*\\/", 4, "INITIAL");
+$lex->push("COMMENT", "(?s:.)", Token::SKIP, ".");
+$lex->build();
+
+$pieces = ["abc ", "12 ", "\"str ing\" ", "/* c x 1 */ ", "\n", "\"a /* b */ c\" ", "/* \"q\" 123 */"];
+$in = "";
+for ($i = 0; $i < 60000; $i++) {
+	$in .= $pieces[($i * 7 + intdiv($i, 3)) % count($pieces)];
+}
+
+$lex->consume($in);
+$seq = sequential($lex);
+var_dump(count($seq));
+var_dump($seq === $lex->tokenize(4, null, true));
+var_dump($seq === $lex->tokenize(7, null, true));
+
+$rlex = new RLexer;
+$rlex->pushState("NEST");
+$rlex->push("INITIAL", "[a-z]+", 1, ".");
+$rlex->push("INITIAL", "\\s+", Token::SKIP, ".");
+$rlex->push("*", "\\(", 2, ">NEST");
+$rlex->push("NEST", "[^()]+", 3, ".");
+$rlex->push("NEST", "\\)", 4, "<");
+$rlex->build();
+
+$pieces = ["abc ", "(x y (z) w) ", "q\n", "((a)) "];
+$in = "";
+for ($i = 0; $i < 60000; $i++) {
+	$in .= $pieces[($i * 5 + intdiv($i, 7)) % count($pieces)];
+}
+
+$rlex->consume($in);
+$seq = sequential($rlex);
+var_dump(count($seq));
+var_dump($seq === $rlex->tokenize(4, null, true));
+
+try {
+	$lex->tokenize(4, "^", true);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+int(51429)
+bool(true)
+bool(true)
+int(197142)
+bool(true)
+Resync pattern can't be used with speculative lexing
+==DONE==
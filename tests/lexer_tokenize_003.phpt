@@ -0,0 +1,43 @@
+--TEST--
+Lexer tokenize with tokens spanning a newline
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Lexer, Token};
+
+$lex = new Lexer;
+$lex->push("[^,\"\\n]+", 1);
+$lex->push("\"([^\"]|\"\")*\"", 2);
+$lex->push(",", 3);
+$lex->push("\\n", 4);
+$lex->build();
+
+/* Quoted fields with embedded newlines, a split after one of them
+	starts in the middle of a field. */
+$rows = ["a,\"x\ny\nz\",b\n", "cc,\"q\"\"r\",dd\n", "e,f,\"g\n\"\n"];
+$in = "";
+for ($i = 0; $i < 30000; $i++) {
+	$in .= $rows[$i % count($rows)];
+}
+
+$lex->consume($in);
+$seq = [];
+$lex->advance();
+while (Token::EOI != $lex->getToken()->id) {
+	$seq[] = [$lex->getToken()->id, $lex->marker, $lex->cursor];
+	$lex->advance();
+}
+
+var_dump(count($seq));
+var_dump($seq === $lex->tokenize(4));
+var_dump($seq === $lex->tokenize(7));
+
+?>
+==DONE==
+--EXPECT--
+int(180000)
+bool(true)
+bool(true)
+==DONE==
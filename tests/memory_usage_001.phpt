@@ -0,0 +1,70 @@
+--TEST--
+Lexer and parser memory usage
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Lexer, RLexer, Token};
+
+function check(array $m)
+{
+	$total = $m["total"];
+	unset($m["total"]);
+	echo implode(" ", array_keys($m)), " ", var_export(array_sum($m) == $total, true), "\n";
+}
+
+$p = new Parser;
+$p->token("NUM");
+$p->left("'+'");
+$p->push("start", "exp");
+$p->push("exp", "exp '+' exp");
+$p->push("exp", "NUM");
+check($p->memoryUsage());
+var_dump(0 == $p->memoryUsage()["table"]);
+$p->build();
+check($p->memoryUsage());
+var_dump($p->memoryUsage()["table"] > 0, $p->memoryUsage()["rules"] > 0);
+
+$lexers = [new Lexer, new RLexer];
+foreach ($lexers as $lex) {
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	$lex->push("\\+", $p->tokenId("'+'"));
+	$lex->push("\\s+", Token::SKIP);
+	$m = $lex->memoryUsage();
+	check($m);
+	var_dump(0 == $m["dfa"] && 0 == $m["lookup"]);
+	$lex->build();
+	$m = $lex->memoryUsage();
+	/* A char to class table of 16 bit ids per lexer state. */
+	var_dump($m["lookup"] >= 256 * 2, $m["dfa"] > 0);
+
+	$in = str_repeat("1 + ", 2500) . "1";
+	$lex->consume($in);
+	var_dump($lex->memoryUsage()["input"] >= strlen($in) * (Parle\INTERNAL_UTF32 ? 4 : 1));
+}
+
+var_dump($p->validate($in, $lexers[0]));
+check($p->memoryUsage());
+
+?>
+==DONE==
+--EXPECT--
+rules table productions checkpoints true
+bool(true)
+rules table productions checkpoints true
+bool(true)
+bool(true)
+rules dfa lookup keywords input checkpoints true
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+rules dfa lookup keywords input checkpoints true
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+rules table productions checkpoints true
+==DONE==
@@ -0,0 +1,41 @@
+--TEST--
+Parser build with default reductions and unit rule elimination
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\Parser;
+
+require __DIR__ . "/expr_grammar.inc";
+
+foreach ([0, Parser::DEFAULT_REDUCTIONS, Parser::ELIMINATE_UNIT_RULES] as $flags) {
+	$p = expr_parser($flags);
+	$lex = expr_lexer($p);
+	$lex->build();
+	foreach (["1+2*3", "(1+2", "1+*2"] as $in) {
+		$reduces = [];
+		$p->consume($in, $lex);
+		while (Parser::ACTION_ERROR != $p->action && Parser::ACTION_ACCEPT != $p->action) {
+			if (Parser::ACTION_REDUCE == $p->action) {
+				$reduces[] = $p->reduceId;
+			}
+			$p->advance();
+		}
+		echo $flags, " ", $in, " ", var_export($p->validate($in, $lex), true), " ", implode(" ", $reduces), "\n";
+	}
+}
+
+?>
+==DONE==
+--EXPECT--
+0 1+2*3 true 6 4 2 6 4 6 5 3 1 0
+0 (1+2 false 6 4 2 6 4 3 1
+0 1+*2 false 6 4 2
+1 1+2*3 true 6 4 2 6 4 6 5 3 1 0
+1 (1+2 false 6 4 2 6 4 3 1
+1 1+*2 false 6 4 2
+2 1+2*3 true 6 2 6 6 5 3 1
+2 (1+2 false 6 2 6 3 1
+2 1+*2 false 6 2
+==DONE==
@@ -0,0 +1,64 @@
+--TEST--
+Parser checkpoint and restore
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, ParserException, Lexer, Token};
+
+$p = new Parser;
+$p->token("WORD");
+$p->push("START", "LIST");
+$r1 = $p->push("LIST", "WORD");
+$r2 = $p->push("LIST", "LIST WORD");
+$p->build();
+
+$lex = new Lexer;
+$lex->push("[a-z]+", $p->tokenId("WORD"));
+$lex->push("[ ]+", Token::SKIP);
+$lex->build();
+
+$p->consume("a b c", $lex);
+
+$cp = -1;
+$pass = function () use ($p, $r1, $r2, &$cp) {
+	do {
+		switch ($p->action) {
+		case Parser::ACTION_ERROR:
+			throw new ParserException("Error");
+		case Parser::ACTION_REDUCE:
+			switch ($p->reduceId) {
+			case $r1:
+				if ($cp < 0) {
+					$cp = $p->checkpoint();
+				}
+				echo "LIST -> WORD ", $p->sigil(0), "\n";
+				break;
+			case $r2:
+				echo "LIST -> LIST WORD ", $p->sigil(1), "\n";
+				break;
+			}
+			break;
+		}
+		$p->advance();
+	} while (Parser::ACTION_ACCEPT != $p->action);
+	echo "accept\n";
+};
+
+$pass();
+$p->restore($cp);
+$pass();
+
+?>
+==DONE==
+--EXPECT--
+LIST -> WORD a
+LIST -> LIST WORD b
+LIST -> LIST WORD c
+accept
+LIST -> WORD a
+LIST -> LIST WORD b
+LIST -> LIST WORD c
+accept
+==DONE==
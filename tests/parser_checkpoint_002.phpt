@@ -0,0 +1,84 @@
+--TEST--
+Parser checkpoints after the lexer input was replaced
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, ParserException, Lexer, Token};
+
+$p = new Parser;
+$p->token("WORD");
+$p->push("START", "LIST");
+$p->push("LIST", "WORD");
+$p->push("LIST", "LIST WORD");
+$p->build();
+
+$lex = new Lexer;
+$lex->push("[a-z]+", $p->tokenId("WORD"));
+$lex->push("[ ]+", Token::SKIP);
+$lex->build();
+
+$q = clone $p;
+
+$p->consume("a b c", $lex);
+$p->advance();
+$cp = $p->checkpoint();
+
+/* Another parser on the same lexer. */
+$q->validate("d e", $lex);
+try {
+	$p->restore($cp);
+} catch (ParserException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+$p->consume("a b c", $lex);
+$p->advance();
+$cp = $p->checkpoint();
+$lex->consume("f g");
+try {
+	$p->restore($cp);
+} catch (ParserException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+/* Checkpoints taken on the current input restore fine. */
+$p->consume("a b c", $lex);
+$p->advance();
+$cp = $p->checkpoint();
+while (Parser::ACTION_ACCEPT != $p->action) {
+	$p->advance();
+}
+$p->restore($cp);
+while (Parser::ACTION_ACCEPT != $p->action && Parser::ACTION_ERROR != $p->action) {
+	$p->advance();
+}
+var_dump(Parser::ACTION_ACCEPT == $p->action);
+
+/* A checkpoint doesn't outlive consume(), not even of the same input. */
+$lex->consume("a b c");
+try {
+	$p->restore($cp);
+} catch (ParserException $e) {
+	echo $e->getMessage(), "\n";
+}
+$p->consume("a b c", $lex);
+$p->advance();
+$cp = $p->checkpoint();
+$p->consume("a b c", $lex);
+try {
+	$p->restore($cp);
+} catch (ParserException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+Stale checkpoint 0, the lexer input was replaced
+Stale checkpoint 0, the lexer input was replaced
+bool(true)
+Stale checkpoint 0, the lexer input was replaced
+Invalid checkpoint 0
+==DONE==
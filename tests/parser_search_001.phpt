@@ -0,0 +1,68 @@
+--TEST--
+Parser search() and searchAll() with captures
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Lexer, Token, LexerException};
+
+foreach ([0, Parser::DEFAULT_REDUCTIONS | Parser::ELIMINATE_UNIT_RULES] as $flags) {
+	$p = new Parser;
+	$p->token("NAME NUM SELECT FROM WHERE");
+	$p->push("query", "SELECT (cols) FROM (NAME) opt_where");
+	$p->push("cols", "NAME | cols ',' NAME");
+	$p->push("opt_where", "%empty | WHERE (NAME '=' NUM)");
+	$p->build($flags);
+
+	$lex = new Lexer;
+	$lex->push("(?i:select)", $p->tokenId("SELECT"));
+	$lex->push("(?i:from)", $p->tokenId("FROM"));
+	$lex->push("(?i:where)", $p->tokenId("WHERE"));
+	$lex->push("[a-z_]+", $p->tokenId("NAME"));
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	$lex->push(",", $p->tokenId("','"));
+	$lex->push("=", $p->tokenId("'='"));
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	$in = "log: user ran SELECT a, b FROM t WHERE x = 5 ok; then select c from u; then SELECT FROM bad; select q from r where z = ; done #";
+
+	echo json_encode($p->search($in, $lex)), "\n";
+	foreach ($p->searchAll($in, $lex) as $m) {
+		$groups = [];
+		foreach ($m as $spans) {
+			$groups[] = implode("|", array_map(function ($s) use ($in) { return substr($in, $s[0], $s[1] - $s[0]); }, $spans));
+		}
+		echo implode(" / ", $groups), "\n";
+	}
+	var_dump($p->search("no query here", $lex));
+	var_dump($p->searchAll("", $lex));
+}
+
+$lex->callout(1, function () {});
+try {
+	$p->search($in, $lex);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+[[[14,44]],[[21,25]],[[31,32]],[[39,44]]]
+SELECT a, b FROM t WHERE x = 5 / a, b / t / x = 5
+select c from u / c / u / 
+select q from r / q / r / 
+NULL
+array(0) {
+}
+[[[14,44]],[[21,25]],[[31,32]],[[39,44]]]
+SELECT a, b FROM t WHERE x = 5 / a, b / t / x = 5
+select c from u / c / u / 
+select q from r / q / r / 
+NULL
+array(0) {
+}
+Callouts are not supported by search()
+==DONE==
@@ -0,0 +1,42 @@
+--TEST--
+Parser validate() error details
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Token};
+
+require __DIR__ . "/expr_grammar.inc";
+
+foreach ([0, Parser::DEFAULT_REDUCTIONS] as $flags) {
+	$p = expr_parser($flags);
+	$lex = expr_lexer($p);
+	$lex->push("\\s+", Token::SKIP);
+	$lex->build();
+
+	foreach (["1+2", "1+*2", "(1+2", "1 2", "1+#"] as $in) {
+		if ($p->validate($in, $lex)) {
+			echo "$flags '$in' valid, last token ", $lex->getToken()->id, "\n";
+			continue;
+		}
+		$err = $p->errorInfo();
+		echo "$flags '$in' ", $err->id == Parser::ERROR_SYNTAX ? "syntax" : "unknown", " error at ", $err->position,
+			" '", $err->token->value, "', expected ", implode(" ", $err->expected), "\n";
+	}
+}
+
+?>
+==DONE==
+--EXPECT--
+0 '1+2' valid, last token 0
+0 '1+*2' syntax error at 2 '*', expected NUM '('
+0 '(1+2' syntax error at 4 '', expected '+' '*' ')'
+0 '1 2' syntax error at 2 '2', expected $ '+' '*'
+0 '1+#' unknown error at 2 '#', expected NUM '('
+1 '1+2' valid, last token 0
+1 '1+*2' syntax error at 2 '*', expected NUM '('
+1 '(1+2' syntax error at 4 '', expected '+' '*' ')'
+1 '1 2' syntax error at 2 '2', expected $ '+' '*'
+1 '1+#' unknown error at 2 '#', expected NUM '('
+==DONE==
@@ -0,0 +1,48 @@
+--TEST--
+Lexer position after Parser::validate() with skipped newlines
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Lexer, Token};
+
+$p = new Parser;
+$p->token("NUM");
+$p->push("start", "exp");
+$p->push("exp", "exp '+' NUM");
+$p->push("exp", "NUM");
+$p->build();
+
+function lexer(Parser $p, $callout)
+{
+	$lex = new Lexer;
+	$lex->push("\\d+", $p->tokenId("NUM"));
+	$lex->push("\\+", $p->tokenId("'+'"));
+	$lex->push("\\s+", Token::SKIP);
+	if ($callout) {
+		/* Takes the parse through the token iterator. */
+		$lex->callout($p->tokenId("NUM"), function () {});
+	}
+	$lex->build();
+	return $lex;
+}
+
+foreach (["1 +\n2 3", "1 +\n2", "\n\n 1 + 2"] as $in) {
+	foreach ([false, true] as $callout) {
+		$lex = lexer($p, $callout);
+		$ret = $p->validate($in, $lex);
+		printf("%s %d:%d %d\n", var_export($ret, true), $lex->line, $lex->column, $lex->marker);
+	}
+}
+
+?>
+==DONE==
+--EXPECT--
+false 0:3 6
+false 0:3 6
+true 0:3 5
+true 0:3 5
+true 0:3 8
+true 0:3 8
+==DONE==
@@ -0,0 +1,77 @@
+--TEST--
+Parser validateMany
+--SKIPIF--
+<?php if (!extension_loaded("parle")) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Lexer, Token, LexerException};
+
+$p = new Parser;
+$p->token("INTEGER");
+$p->left("'+' '-'");
+$p->left("'*' '/'");
+$p->push("start", "exp");
+$p->push("exp", "exp '+' exp");
+$p->push("exp", "exp '-' exp");
+$p->push("exp", "exp '*' exp");
+$p->push("exp", "exp '/' exp");
+$p->push("exp", "INTEGER");
+$p->build();
+
+$lex = new Lexer;
+$lex->push("[+]", $p->tokenId("'+'"));
+$lex->push("[-]", $p->tokenId("'-'"));
+$lex->push("[*]", $p->tokenId("'*'"));
+$lex->push("[/]", $p->tokenId("'/'"));
+$lex->push("\\d+", $p->tokenId("INTEGER"));
+$lex->push("\\s+", Token::SKIP);
+$lex->build();
+
+$in = ["1 + 1", "a" => "33 / ", "100 * 45", 7 => "17 - - 45", "b" => "42"];
+var_dump($p->validateMany($in, $lex));
+
+$many = [];
+for ($i = 0; $i < 1000; $i++) {
+	$many[] = (0 == $i % 3) ? "$i +" : "$i * 2 - 1";
+}
+$expected = [];
+foreach ($many as $k => $s) {
+	$expected[$k] = $p->validate($s, $lex);
+}
+var_dump($expected === $p->validateMany($many, $lex));
+var_dump($expected === $p->validateMany($many, $lex, 4));
+var_dump([] === $p->validateMany([], $lex, 4));
+
+$lex->callout($p->tokenId("INTEGER"), function () {});
+var_dump($p->validateMany(["1 + 2"], $lex));
+try {
+	$p->validateMany(["1 + 2"], $lex, 2);
+} catch (LexerException $e) {
+	echo $e->getMessage(), "\n";
+}
+
+?>
+==DONE==
+--EXPECT--
+array(5) {
+  [0]=>
+  bool(true)
+  ["a"]=>
+  bool(false)
+  [1]=>
+  bool(true)
+  [7]=>
+  bool(false)
+  ["b"]=>
+  bool(true)
+}
+bool(true)
+bool(true)
+bool(true)
+array(1) {
+  [0]=>
+  bool(true)
+}
+Callouts are not supported with multiple threads
+==DONE==
@@ -0,0 +1,75 @@
+--TEST--
+Lexer and parser profiling counters
+--SKIPIF--
+<?php if (!extension_loaded("parle") || !Parle\STATS) print "skip"; ?>
+--FILE--
+<?php
+
+use Parle\{Parser, Lexer};
+
+require __DIR__ . "/expr_grammar.inc";
+
+$p = expr_parser(Parser::DEFAULT_REDUCTIONS | Parser::COMPRESS_TABLE);
+$lex = expr_lexer($p);
+$lex->build();
+
+$names = [0 => "\$end"];
+foreach (["NUM", "'+'", "'*'", "'('", "')'"] as $name) {
+	$names[$p->tokenId($name)] = $name;
+}
+
+function show(Parser $p, Lexer $lex, array $names)
+{
+	$ls = $lex->stats(true);
+	$ps = $p->stats(true);
+	$tokens = [];
+	foreach ($ls["tokens"] as $id => $n) {
+		$tokens[] = "$names[$id]:$n";
+	}
+	$reduces = [];
+	foreach ($ps["reduces"] as $rule => $n) {
+		$reduces[] = "$rule:$n";
+	}
+	echo "tokens ", implode(" ", $tokens), " bytes ", $ls["bytes"], " callouts ", $ls["callouts"], "\n";
+	echo "shifts ", $ps["shifts"], " gotos ", $ps["gotos"], " depth ", $ps["max_depth"], " reduces ", implode(" ", $reduces), "\n";
+}
+
+$phases = $p->stats()["build"];
+echo implode(" ", array_keys($phases)), "\n";
+var_dump(min($phases) >= 0);
+echo implode(" ", array_keys($lex->stats()["build"])), "\n";
+
+var_dump($p->validate("1+2*3", $lex));
+show($p, $lex, $names);
+
+/* The same steps one at a time. */
+$p->consume("1+2*3", $lex);
+while (Parser::ACTION_ERROR != $p->action && Parser::ACTION_ACCEPT != $p->action) {
+	$p->advance();
+}
+show($p, $lex, $names);
+
+/* Reset above, the build phases are kept. */
+var_dump($p->stats()["shifts"], $lex->stats()["tokens"], count($p->stats()["build"]));
+
+$lex->callout($p->tokenId("'+'"), function () {});
+var_dump($p->validate("1+2+3", $lex), $lex->stats()["callouts"]);
+
+?>
+==DONE==
+--EXPECT--
+lalr default_reductions compress
+bool(true)
+build
+bool(true)
+tokens $end:1 NUM:3 '+':1 '*':1 bytes 5 callouts 0
+shifts 6 gotos 10 depth 6 reduces 0:1 1:1 2:1 3:1 4:2 5:1 6:3
+tokens $end:1 NUM:3 '+':1 '*':1 bytes 5 callouts 0
+shifts 6 gotos 10 depth 6 reduces 0:1 1:1 2:1 3:1 4:2 5:1 6:3
+int(0)
+array(0) {
+}
+int(3)
+bool(true)
+int(2)
+==DONE==